@@ -1,6 +1,6 @@
 /*
  * OXRS_LCD.cpp
- * 
+ *
  */
  
 #include "Arduino.h"
@@ -10,28 +10,103 @@
 #include "Free_Fonts.h"             // GFX Free Fonts supplied with TFT_eSPI
 #include "roboto_fonts.h"           // roboto_fonts Created by http://oleddisplay.squix.ch/
 #include "icons.h"                  // resource file for icons
+#include "OXRS_LCD_trace.h"         // optional timeline tracing
 #include <pgmspace.h>
+#include <new>                      // std::nothrow of the render queue
+#if defined(ESP32)
+#include <esp_heap_caps.h>          // DMA capable draw buffers
+#endif
 
+#ifdef OXRS_LCD_TRACE
+lcd_trace_hook _lcd_trace_hook = NULL;
+lcd_trace_tft tft;                  // Invoke library, primitives traced
+
+void setLcdTraceHook(lcd_trace_hook hook)
+{
+  _lcd_trace_hook = hook;
+}
+#else
 TFT_eSPI tft = TFT_eSPI();          // Invoke library
+#endif
+
+// a draw buffer, DMA capable for the transport
+static uint16_t * draw_buffer_alloc(void)
+{
+#if defined(ESP32)
+  return (uint16_t *)heap_caps_malloc(DRAW_BUFFER_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+#else
+  return (uint16_t *)malloc(DRAW_BUFFER_PIXELS * sizeof(uint16_t));
+#endif
+}
 
+#ifndef OXRS_LCD_NO_ETHERNET
 // for ethernet
 OXRS_LCD::OXRS_LCD(EthernetClass& ethernet, OXRS_MQTT& mqtt)
 {
+#ifndef OXRS_LCD_NO_WIFI
   _wifi = NULL;
+#endif
   _ethernet = &ethernet;
   _mqtt = &mqtt;
 
   memset(_io_values, 0, sizeof(_io_values));
+  memset(_pin_type, 0, sizeof(_pin_type));
+  memset(_pin_invert, 0, sizeof(_pin_invert));
+  memset(_pin_disabled, 0, sizeof(_pin_disabled));
+  memset(&_layout_config_in, 0, sizeof(_layout_config_in));
+  memset(&_layout_config_out, 0, sizeof(_layout_config_out));
+  memset(_cells_in, 0, sizeof(_cells_in));
+  memset(_cells_out, 0, sizeof(_cells_out));
+  memset(_diag_changes, 0, sizeof(_diag_changes));
+  memset(_latency_pending, 0, sizeof(_latency_pending));
+  memset(&_diag_values, 0, sizeof(_diag_values));
+  _drawn_clear();
+  _schedule_clear();
+  resetRenderStats();
 }
+#endif
 
+#ifndef OXRS_LCD_NO_WIFI
 // for wifi
 OXRS_LCD::OXRS_LCD(WiFiClass& wifi, OXRS_MQTT& mqtt)
 {
   _wifi = &wifi;
+#ifndef OXRS_LCD_NO_ETHERNET
   _ethernet = NULL;
+#endif
   _mqtt = &mqtt;
 
   memset(_io_values, 0, sizeof(_io_values));
+  memset(_pin_type, 0, sizeof(_pin_type));
+  memset(_pin_invert, 0, sizeof(_pin_invert));
+  memset(_pin_disabled, 0, sizeof(_pin_disabled));
+  memset(&_layout_config_in, 0, sizeof(_layout_config_in));
+  memset(&_layout_config_out, 0, sizeof(_layout_config_out));
+  memset(_cells_in, 0, sizeof(_cells_in));
+  memset(_cells_out, 0, sizeof(_cells_out));
+  memset(_diag_changes, 0, sizeof(_diag_changes));
+  memset(_latency_pending, 0, sizeof(_latency_pending));
+  memset(&_diag_values, 0, sizeof(_diag_values));
+  _drawn_clear();
+  _schedule_clear();
+  resetRenderStats();
+}
+#endif
+
+OXRS_LCD::~OXRS_LCD()
+{
+#if defined(ESP32)
+  stopRenderTask();
+#endif
+  delete _queue;
+  free(_wants);
+  free(_shadow);
+  free(_tile_hash);
+  free(_draw_buffer_next == _draw_pixels ? _draw_buffer : _draw_buffer_next);
+  free(_draw_pixels);
+#ifndef OXRS_LCD_NO_LED_TILES
+  free(_led_tiles);
+#endif
 }
 
 void OXRS_LCD::begin()
@@ -40,6 +115,9 @@ void OXRS_LCD::begin()
   tft.begin();
   tft.setRotation(1);
   tft.fillRect(0, 0, 240, 240,  TFT_BLACK);
+  _draws.begin();                   // allocated here, the painters draw straight away without
+  if (!_draw_pixels) _draw_buffer = _draw_pixels = draw_buffer_alloc();
+  _drawn_clear();
 
   // set up for backlight dimming (PWM)
   ledcSetup(BL_PWM_CHANNEL, BL_PWM_FREQ, BL_PWM_RESOLUTION);
@@ -54,12 +132,12 @@ void OXRS_LCD::begin()
 //    1 .. 600   : time in seconds (10 minutes max) range can be defined by the UI, not checked here
 void OXRS_LCD::setOnTimeDisplay(int ontime_display)
 {
-  _ontime_display_ms = ontime_display * 1000;
+  _setting(SETTING_ONTIME_DISPLAY, ontime_display);
 }
 
 void OXRS_LCD::setOnTimeEvent(int ontime_event)
 {
-  _ontime_event_ms = ontime_event * 1000;
+  _setting(SETTING_ONTIME_EVENT, ontime_event);
 }
 
 // brightness_on  : brightness when on        (default: 100 %)
@@ -67,15 +145,76 @@ void OXRS_LCD::setOnTimeEvent(int ontime_event)
 // value range    : 0 .. 100  : brightness in %  range can be defined by the UI, not checked here
 void OXRS_LCD::setBrightnessOn(int brightness_on)
 {
-  _brightness_on = brightness_on;
+  _setting(SETTING_BRIGHTNESS_ON, brightness_on);
 }
 
 void OXRS_LCD::setBrightnessDim(int brightness_dim)
 {
-  _brightness_dim = brightness_dim;
+  _setting(SETTING_BRIGHTNESS_DIM, brightness_dim);
+}
+
+// the render side's state, posted with the queue on
+void OXRS_LCD::_setting(uint8_t setting, int32_t value)
+{
+  if (_queue_on)
+  {
+    _post(RECORD_SETTING, setting, 0, value);
+    return;
+  }
+  _set_setting(setting, value);
+}
+
+void OXRS_LCD::_set_setting(uint8_t setting, int32_t value)
+{
+  switch (setting)
+  {
+    case SETTING_ONTIME_DISPLAY:  _ontime_display_ms = value * 1000; break;
+    case SETTING_ONTIME_EVENT:    _ontime_event_ms = value * 1000; break;
+    case SETTING_BRIGHTNESS_ON:   _brightness_on = value; break;
+    case SETTING_BRIGHTNESS_DIM:  _brightness_dim = value; break;
+    case SETTING_IP_POS:          _yIP = value; break;
+    case SETTING_MAC_POS:         _yMAC = value; break;
+    case SETTING_MQTT_POS:        _yMQTT = value; break;
+    case SETTING_TEMP_POS:        _yTEMP = value; break;
+    case SETTING_RENDER_BUDGET:   _set_budget(value); break;
+  }
 }
 
 void OXRS_LCD::setPinType(uint8_t mcp, uint8_t pin, int type)
+{
+  if (_queue_on)
+  {
+    // the render side forces the next io_value of mcp, post it again
+    bitClear(_posted_mcps, mcp);
+    _post(RECORD_PIN_TYPE, mcp, pin | (type << 8));
+    return;
+  }
+  _set_pin_type(mcp, pin, type);
+}
+
+void OXRS_LCD::setPinInvert(uint8_t mcp, uint8_t pin, int invert)
+{
+  if (_queue_on)
+  {
+    bitClear(_posted_mcps, mcp);
+    _post(RECORD_PIN_INVERT, mcp, pin | (invert << 8));
+    return;
+  }
+  _set_pin_invert(mcp, pin, invert);
+}
+
+void OXRS_LCD::setPinDisabled(uint8_t mcp, uint8_t pin, int disabled)
+{
+  if (_queue_on)
+  {
+    bitClear(_posted_mcps, mcp);
+    _post(RECORD_PIN_DISABLED, mcp, pin | (disabled << 8));
+    return;
+  }
+  _set_pin_disabled(mcp, pin, disabled);
+}
+
+void OXRS_LCD::_set_pin_type(uint8_t mcp, uint8_t pin, int type)
 {
   // mcp/port/pin are zero-based, but index is 1-based (to match the firmware config)
   uint8_t port = (mcp * 4) + (pin / 4);
@@ -98,21 +237,23 @@ void OXRS_LCD::setPinType(uint8_t mcp, uint8_t pin, int type)
   
   // update our port type global
   bitWrite(_pin_type[mcp], pin, type);
+  _record_config(mcp);
 
   // force content to be updated (reset MCP initialised flag)
   bitWrite(_mcps_initialised, mcp, 0);
 }
 
-void OXRS_LCD::setPinInvert(uint8_t mcp, uint8_t pin, int invert)
+void OXRS_LCD::_set_pin_invert(uint8_t mcp, uint8_t pin, int invert)
 {
   // update our port invert global
   bitWrite(_pin_invert[mcp], pin, invert);
+  _record_config(mcp);
 
   // force content to be updated (reset MCP initialised flag)
   bitWrite(_mcps_initialised, mcp, 0);
 }
 
-void OXRS_LCD::setPinDisabled(uint8_t mcp, uint8_t pin, int disabled)
+void OXRS_LCD::_set_pin_disabled(uint8_t mcp, uint8_t pin, int disabled)
 {
   // mcp/port/pin are zero-based, but index is 1-based (to match the firmware config)
   uint8_t port = (mcp * 4) + (pin / 4);
@@ -122,6 +263,7 @@ void OXRS_LCD::setPinDisabled(uint8_t mcp, uint8_t pin, int disabled)
   
   // update our port disabled global
   bitWrite(_pin_disabled[mcp], pin, disabled);
+  _record_config(mcp);
 
   // force content to be updated (reset MCP initialised flag)
   bitWrite(_mcps_initialised, mcp, 0);
@@ -130,21 +272,21 @@ void OXRS_LCD::setPinDisabled(uint8_t mcp, uint8_t pin, int disabled)
 // set info display row positions (0 hides specific member)
 void OXRS_LCD::setIPpos(int yPos)
 {
-  _yIP = yPos;
+  _setting(SETTING_IP_POS, yPos);
 }
 
 void OXRS_LCD::setMACpos(int yPos)
 {
-  _yMAC = yPos;
+  _setting(SETTING_MAC_POS, yPos);
 }
 
 void OXRS_LCD::setMQTTpos(int yPos)
 {
-  _yMQTT = yPos;
+  _setting(SETTING_MQTT_POS, yPos);
 }
 void OXRS_LCD::setTEMPpos(int yPos)
 {
-  _yTEMP = yPos;
+  _setting(SETTING_TEMP_POS, yPos);
 }
 
 TFT_eSPI* OXRS_LCD::getTft()
@@ -152,59 +294,284 @@ TFT_eSPI* OXRS_LCD::getTft()
   return &tft;
 }
 
-int OXRS_LCD::drawHeader(const char * fwShortName, const char * fwMaker, const char * fwVersion, const char * fwPlatform, const uint8_t * fwLogo)
+/*
+ * io trace recording :
+ * write every io_value process() acts on, with its time, to out (e.g. a
+ * LittleFS file or Serial), so real installations can be replayed off the board
+ * start after drawPorts(), the header holds the port layout
+ *
+ * header : IO_TRACE_MAGIC, IO_TRACE_VERSION, port_layout (16 bit), mcps_found (8 bit)
+ *          followed by a config record for every mcp
+ * record : varint of (ms since last record << 4 | flags | mcp), followed by
+ *            io_value (16 bit)                                 flags == 0
+ *            pin_type, pin_invert, pin_disabled (16 bit each)  flags == IO_TRACE_CONFIG
+ * multi byte values are little endian, the varint 7 bits per byte (low first)
+ * with the queue on, out is written by the render side until stopRecording()
+ * has been drained, the firmware must not write to it meanwhile
+ */
+void OXRS_LCD::startRecording(Print * out)
 {
-  char buffer[30];
-  int return_code;
-
-  int logo_w = 40;
-  int logo_h = 40;
-  int logo_x = 0;
-  int logo_y = 0;
-
-  // 1. try to draw maker supplied /logo.bmp from SPIFFS
-  // 2, if not successful try to draw maker supplied logo via fwLogo (fwLogo from PROGMEM)
-  // 3. if not successful draw embedded OXRS logo from PROGMEM
-  return_code = LCD_INFO_LOGO_FROM_SPIFFS;
-  if (!_drawBmp("/logo.bmp", logo_x, logo_y, logo_w, logo_h))
+  if (_queue_on)
   {
-    return_code = LCD_INFO_LOGO_FROM_PROGMEM;
-    if (!fwLogo || !_drawBmp_P(fwLogo, logo_x, logo_y, logo_w, logo_h))
-    {  
-      return_code = LCD_INFO_LOGO_DEFAULT;
-      if (!_drawBmp_P(OXRS_logo, logo_x, logo_y, logo_w, logo_h))
+    // the Print goes into the recorder ring, taken from there by its record
+    uint32_t spins = 0;
+    _post_overflow();
+    while (_overflow_mcps || !_queue->records.space() || !_queue->recorders.space())
+    {
+      if (!_render_waiting(spins))
       {
-        return_code = LCD_ERR_NO_LOGO;
+        _queue_dropped++;
+        return;
       }
+      _post_overflow();
+    }
+    _queue->recorders.push(out);
+    _post(RECORD_RECORDING);
+    return;
+  }
+  _start_recording(out);
+}
+
+void OXRS_LCD::_start_recording(Print * out)
+{
+  _recorder = out;
+  if (!_recorder) return;
+
+  _last_record_ms = millis();
+
+  _recorder->write((const uint8_t *)IO_TRACE_MAGIC, 4);
+  _recorder->write((uint8_t)IO_TRACE_VERSION);
+  _recorder->write((uint8_t)(_port_layout & 0xff));
+  _recorder->write((uint8_t)(_port_layout >> 8));
+  _recorder->write((uint8_t)_mcps_found);
+
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    _record_config(mcp);
+  }
+
+  // record the current io_values with the next process() call
+  _mcps_initialised = 0;
+}
+
+void OXRS_LCD::stopRecording(void)
+{
+  startRecording(NULL);
+}
+
+/*
+ * render statistics :
+ * calls, total, max and a log2 histogram of the time spent in process(),
+ * loop() and the port painters since the last reset
+ */
+const render_stats& OXRS_LCD::getRenderStats(void)
+{
+  // with the queue on the render side copies them between two records, the
+  // last copy is returned when it does not drain
+  if (!_queue_on)
+  {
+    _render_stats.queue_dropped = _queue_dropped;
+    return _render_stats;
+  }
+  _request_stats(RECORD_STATS_COPY);
+  render_stats& copy = _queue->stats[_stats_done.load(std::memory_order_acquire) & 1];
+  copy.queue_dropped = _queue_dropped;
+  return copy;
+}
+
+void OXRS_LCD::resetRenderStats(void)
+{
+  _queue_dropped = 0;
+  if (_queue_on)
+  {
+    _request_stats(RECORD_STATS_RESET);
+    return;
+  }
+  memset(&_render_stats, 0, sizeof(_render_stats));
+  _render_stats.since_ms = millis();
+}
+
+/*
+ * pin change to painted latency :
+ * log-linear histogram, exact below 8 us, then 8 buckets per power of 2
+ * percentiles are reported as the upper edge of their bucket
+ */
+static int latency_bucket(uint32_t us)
+{
+  if (us < 8) return us;
+
+  int octave = 31 - __builtin_clz(us);
+  int bucket = 8 + (octave - 3) * 8 + ((us >> (octave - 3)) & 0x07);
+  return (bucket < LATENCY_BUCKETS) ? bucket : LATENCY_BUCKETS - 1;
+}
+
+static uint32_t latency_bucket_upper(int bucket)
+{
+  if (bucket < 8) return bucket;
+
+  int octave = (bucket - 8) / 8 + 3;
+  uint32_t lower = (uint32_t)(8 + (bucket - 8) % 8) << (octave - 3);
+  return lower + (1UL << (octave - 3)) - 1;
+}
+
+void OXRS_LCD::_add_latency(uint32_t us)
+{
+  latency_stat& latency = _render_stats.latency;
+
+  latency.count++;
+  if (us > latency.max_us) latency.max_us = us;
+  latency.histogram[latency_bucket(us)]++;
+}
+
+// latency in us that percentile % (0 .. 100) of the pin changes stayed within
+uint32_t OXRS_LCD::getLatencyPercentile(int percentile)
+{
+  const latency_stat& latency = getRenderStats().latency;
+  if (!latency.count) return 0;
+
+  uint32_t target = ((uint64_t)latency.count * percentile + 99) / 100;
+  if (target < 1) target = 1;
+
+  uint32_t seen = 0;
+  for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+  {
+    seen += latency.histogram[bucket];
+    if (seen >= target)
+    {
+      uint32_t upper = latency_bucket_upper(bucket);
+      return (upper < latency.max_us) ? upper : latency.max_us;
     }
   }
+  return latency.max_us;
+}
+
+void OXRS_LCD::_record_config(uint8_t mcp)
+{
+  uint16_t config[3] = {_pin_type[mcp], _pin_invert[mcp], _pin_disabled[mcp]};
+  _record(mcp, IO_TRACE_CONFIG, config, 3);
+}
+
+void OXRS_LCD::_record(uint8_t mcp, uint8_t flags, const uint16_t * values, int count)
+{
+  if (!_recorder) return;
+
+  uint32_t now = millis();
+  uint64_t head = ((uint64_t)(now - _last_record_ms) << 4) | flags | (mcp & 0x07);
+  _last_record_ms = now;
+
+  uint8_t buffer[10 + 3 * 2];
+  int len = 0;
+
+  do
+  {
+    buffer[len] = head & 0x7f;
+    head >>= 7;
+    if (head) buffer[len] |= 0x80;
+    len++;
+  } while (head);
+
+  for (int i = 0; i < count; i++)
+  {
+    buffer[len++] = values[i] & 0xff;
+    buffer[len++] = values[i] >> 8;
+  }
+
+  _recorder->write(buffer, len);
+}
+
+int OXRS_LCD::drawHeader(const char * fwShortName, const char * fwMaker, const char * fwVersion, const char * fwPlatform, const uint8_t * fwLogo)
+{
+  LCD_TRACE_SCOPE("drawHeader");
+
+  _header_begin(fwShortName, fwMaker, fwVersion, fwPlatform, fwLogo);
+  while (_header_slice < HEADER_SLICES)
+  {
+    _draw_header_slice();
+  }
+  return _header_result;
+}
+
+// the strings of drawHeader() are kept, not copied, until it is drawn
+void OXRS_LCD::_header_begin(const char * fwShortName, const char * fwMaker, const char * fwVersion, const char * fwPlatform, const uint8_t * fwLogo)
+{
+  _header_text[0] = fwShortName;
+  _header_text[1] = fwMaker;
+  _header_text[2] = fwVersion;
+  _header_text[3] = fwPlatform;
+  _header_logo = fwLogo;
+  _header_result = 0;
+  _header_slice = 0;
+}
+
+// the next slice of drawHeader(): the logo, then the text
+void OXRS_LCD::_draw_header_slice(void)
+{
+  if (_header_slice++ == 0)
+  {
+    _header_result = _draw_logo(_header_logo);
+    return;
+  }
+
+  char buffer[30];
 
   tft.fillRect(42, 0, 240, 40,  TFT_WHITE);
   tft.setTextDatum(TL_DATUM);
   tft.setTextColor(TFT_BLACK);
   tft.setFreeFont(&Roboto_Light_13);
   
-  tft.drawString(fwShortName, 46, 0);
-  tft.drawString(fwMaker, 46, 13);
+  tft.drawString(_header_text[0], 46, 0);
+  tft.drawString(_header_text[1], 46, 13);
  
   tft.drawString("Version", 46, 26); 
-  sprintf(buffer, ": %s / %s", fwVersion, fwPlatform); 
+  sprintf(buffer, ": %s / %s", _header_text[2], _header_text[3]); 
   tft.drawString(buffer, 46+50, 26); 
   
   tft.setTextColor(TFT_WHITE);
   tft.setTextDatum(TC_DATUM);
   tft.setFreeFont(&Roboto_Mono_Thin_13);
   
+#ifndef OXRS_LCD_NO_ETHERNET
   if (_ethernet)
   {
     tft.drawString("Starting ethernet...", 240/2 , 50); 
   }
+#endif
   
+#ifndef OXRS_LCD_NO_WIFI
   if (_wifi)
   {
     tft.drawString("Starting WiFi...", 240/2 , 50); 
   }
-  
+#endif
+}
+
+int OXRS_LCD::_draw_logo(const uint8_t * fwLogo)
+{
+  int return_code;
+
+  int logo_w = 40;
+  int logo_h = 40;
+  int logo_x = 0;
+  int logo_y = 0;
+
+  // 1. try to draw maker supplied /logo.bmp from SPIFFS
+  // 2, if not successful try to draw maker supplied logo via fwLogo (fwLogo from PROGMEM)
+  // 3. if not successful draw embedded OXRS logo from PROGMEM
+#ifndef OXRS_LCD_NO_BMP_FILE
+  return_code = LCD_INFO_LOGO_FROM_SPIFFS;
+  if (!_drawBmp("/logo.bmp", logo_x, logo_y, logo_w, logo_h))
+#endif
+  {
+    return_code = LCD_INFO_LOGO_FROM_PROGMEM;
+    if (!fwLogo || !_drawBmp_P(fwLogo, logo_x, logo_y, logo_w, logo_h))
+    {  
+      return_code = LCD_INFO_LOGO_DEFAULT;
+      if (!_drawBmp_P(OXRS_logo, logo_x, logo_y, logo_w, logo_h))
+      {
+        return_code = LCD_ERR_NO_LOGO;
+      }
+    }
+  }
   return return_code;
 }
 
@@ -214,11 +581,129 @@ int OXRS_LCD::drawHeader(const char * fwShortName, const char * fwMaker, const c
 */
 void OXRS_LCD::drawPorts(int port_layout, uint8_t mcps_found)
 { 
+  LCD_TRACE_SCOPE("drawPorts");
+  write_scope write(*this);
+  _write_open();
+
+  _ports_begin(port_layout, mcps_found);
+  while (_ports_slice < _ports_slices)
+  {
+    _draw_ports_slice();
+  }
+}
+
+/*
+ * boot screen drawn by loop() :
+ * startDrawHeader() and startDrawPorts() only take the arguments, loop()
+ * draws the logo, the header text, one MCP block of ports after the other
+ * and the event bar, for DRAW_SLICE_US (or the render budget) per call and
+ * at least one slice. the rest of loop() waits until the screen is drawn,
+ * so the firmware can bring up the network meanwhile. pin changes given to
+ * process() before their ports are drawn are painted once they are.
+ * the strings and logo of startDrawHeader() have to stay until then, both
+ * calls are made before the render queue is turned on
+ */
+void OXRS_LCD::startDrawHeader(const char * fwShortName, const char * fwMaker, const char * fwVersion, const char * fwPlatform, const uint8_t * fwLogo)
+{
+  _header_begin(fwShortName, fwMaker, fwVersion, fwPlatform, fwLogo);
+}
+
+void OXRS_LCD::startDrawPorts(int port_layout, uint8_t mcps_found)
+{
+  _ports_begin(port_layout, mcps_found);
+}
+
+bool OXRS_LCD::screenDrawn(void)
+{
+  if (_queue_on) return _shown_screen_drawn.load(std::memory_order_relaxed);
+  return _screen_drawn();
+}
+
+bool OXRS_LCD::_screen_drawn(void)
+{
+  return _header_slice >= HEADER_SLICES && _ports_slice >= _ports_slices;
+}
+
+// what drawHeader() returns, 0 until the logo is drawn
+int OXRS_LCD::getHeaderResult(void)
+{
+  if (_queue_on) return _shown_header_result.load(std::memory_order_relaxed);
+  return _header_result;
+}
+
+// false when time ran out with slices left
+bool OXRS_LCD::_draw_slices(uint32_t start_us)
+{
+  LCD_TRACE_SCOPE("_draw_slices");
+  write_scope write(*this);
+  uint32_t slice_us = _budget_us ? _budget_us : DRAW_SLICE_US;
+
+  bool sliced = false;
+  while (!_screen_drawn())
+  {
+    if (sliced && (uint32_t)(micros() - start_us) >= slice_us) return false;
+    sliced = true;
+
+    if (_header_slice < HEADER_SLICES)
+    {
+      _draw_header_slice();
+      continue;
+    }
+    _draw_ports_slice();
+    _flush_draws();
+  }
+
+  // the MCPs that came in meanwhile, forced as their first io_value
+  uint8_t deferred = _ports_deferred;
+  _ports_deferred = 0;
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    if (bitRead(deferred, mcp)) _process(mcp, _io_values[mcp]);
+  }
+  return !_over_budget(start_us);
+}
+
+// the layout of drawPorts(), nothing drawn yet (see _draw_ports_slice)
+void OXRS_LCD::_ports_begin(int port_layout, uint8_t mcps_found)
+{
   _port_layout = port_layout;
   _mcps_found = mcps_found;
   _mcps_initialised = 0;
   _mcp_output_pins = 16;
   _mcp_output_start = 8;
+  _drawn_clear();
+  _schedule_clear();
+
+  // outline of the ports, copied to _layout_config_in/_out for the painters
+  layout_config config = {};
+  memset(&_layout_config_in, 0, sizeof(_layout_config_in));
+  memset(&_layout_config_out, 0, sizeof(_layout_config_out));
+
+  // the pin loop of the layout group, process() calls it without looking at
+  // the layout again. the same for the painters of the LEDs left pending
+  _paint_in_fn = &OXRS_LCD::_update_input;
+  _paint_out_fn = &OXRS_LCD::_update_output;
+  switch (_getPortLayoutGroup(_port_layout))
+  {
+    case PORT_LAYOUT_GROUP_INPUT:
+      _process_pins_fn = &OXRS_LCD::_process_pins<PORT_LAYOUT_GROUP_INPUT>;
+      break;
+    case PORT_LAYOUT_GROUP_OUTPUT:
+      _process_pins_fn = &OXRS_LCD::_process_pins<PORT_LAYOUT_GROUP_OUTPUT>;
+      break;
+    case PORT_LAYOUT_GROUP_SMOKE:
+      _process_pins_fn = &OXRS_LCD::_process_pins<PORT_LAYOUT_GROUP_SMOKE>;
+#ifndef OXRS_LCD_NO_IO_48
+      _paint_in_fn = &OXRS_LCD::_update_io_48;
+      _paint_out_fn = &OXRS_LCD::_update_io_48;
+#endif
+      break;
+    case PORT_LAYOUT_GROUP_HYBRID:
+      _process_pins_fn = &OXRS_LCD::_process_pins<PORT_LAYOUT_GROUP_HYBRID>;
+      break;
+    default:
+      _process_pins_fn = &OXRS_LCD::_process_pins<0>;
+  }
  
   // handle input configurations
   if (_getPortLayoutGroup(_port_layout) == PORT_LAYOUT_GROUP_INPUT)
@@ -235,52 +720,40 @@ void OXRS_LCD::drawPorts(int port_layout, uint8_t mcps_found)
     switch (_port_layout) 
     {
       case PORT_LAYOUT_INPUT_32:
-        _layout_config.x = 0;
-        _layout_config.y = 151;
-        _layout_config.xo = 25+47;
-        _layout_config.bw = 23;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 32;
+        config.x = 0;
+        config.y = 151;
+        config.xo = 25+47;
+        config.bw = 23;
+        config.bh = 19;
+        config.index_max = 32;
         break;
       case PORT_LAYOUT_INPUT_64:
-        _layout_config.x = 0;
-        _layout_config.y = 151;
-        _layout_config.xo = 25; 
-        _layout_config.bw = 23;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 64;
+        config.x = 0;
+        config.y = 151;
+        config.xo = 25; 
+        config.bw = 23;
+        config.bh = 19;
+        config.index_max = 64;
         break;
       case PORT_LAYOUT_INPUT_96:
-        _layout_config.x = 0;
-        _layout_config.y = 151;
-        _layout_config.xo = 2; 
-        _layout_config.bw = 19;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 96;
+        config.x = 0;
+        config.y = 151;
+        config.xo = 2; 
+        config.bw = 19;
+        config.bh = 19;
+        config.index_max = 96;
         break;
       case PORT_LAYOUT_INPUT_128:
-        _layout_config.x = 0;
-        _layout_config.y = 130;
-        _layout_config.xo = 25; 
-        _layout_config.bw = 23;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 128;
+        config.x = 0;
+        config.y = 130;
+        config.xo = 25; 
+        config.bw = 23;
+        config.bh = 19;
+        config.index_max = 128;
         break;
     }
-    // draw outline as configured
-    for (int index = 1; index <= _layout_config.index_max; index += 16)
-    {
-      int state = (bitRead(mcps_found, 0)) ? PORT_STATE_OFF : PORT_STATE_NA;
-      for (int i = 0; i < 16; i++)
-      {
-        if ((i % 4) == 0)
-        {
-          _update_input(TYPE_FRAME, index+i, state);
-        }
-        _update_input(TYPE_STATE, index+i, state);
-      }
-      mcps_found >>= 1;
-    } 
+    _layout_config_in = config;
+    _build_input_cells(_port_layout == PORT_LAYOUT_INPUT_96);
   }   
   
   // handle output configurations
@@ -311,81 +784,62 @@ void OXRS_LCD::drawPorts(int port_layout, uint8_t mcps_found)
     {
       case PORT_LAYOUT_OUTPUT_32:
       case PORT_LAYOUT_OUTPUT_32_8:
-        _layout_config.x = 0;
-        _layout_config.y = 159;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 32;
-        frame_h = _layout_config.bh + 4;
+        config.x = 0;
+        config.y = 159;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 32;
+        frame_h = config.bh + 4;
         break;
       case PORT_LAYOUT_OUTPUT_64:
       case PORT_LAYOUT_OUTPUT_64_8:
-        _layout_config.x = 0;
-        _layout_config.y = 148;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 64;
-        frame_h = _layout_config.bh * 2 + 6;
+        config.x = 0;
+        config.y = 148;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 64;
+        frame_h = config.bh * 2 + 6;
         break;
       case PORT_LAYOUT_OUTPUT_96:
-        _layout_config.x = 0;
-        _layout_config.y = 138;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 96;
-        frame_h = _layout_config.bh * 3 + 8;
+        config.x = 0;
+        config.y = 138;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 96;
+        frame_h = config.bh * 3 + 8;
         break;
       case PORT_LAYOUT_OUTPUT_128:
-        _layout_config.x = 0;
-        _layout_config.y = 127;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 128;
-        frame_h = _layout_config.bh * 4 + 10;
+        config.x = 0;
+        config.y = 127;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 128;
+        frame_h = config.bh * 4 + 10;
         break;
     }
-    // draw outline as configured   
-    tft.fillRect(0, _layout_config.y-2, 240, frame_h,  TFT_WHITE);
-    for (int index = 1; index <= _layout_config.index_max; index += _mcp_output_pins)
-    {
-      int state = (bitRead(mcps_found, 0)) ? PORT_STATE_OFF : PORT_STATE_NA;
-      for (int i = 0; i < _mcp_output_pins; i++)
-      {
-        _update_output(TYPE_FRAME, index+i, state);
-        _update_output(TYPE_STATE, index+i, state);
-      }
-      mcps_found >>= 1;
-    }  
+    _layout_config_out = config;
+    _build_output_cells();
   }
   
+#ifndef OXRS_LCD_NO_IO_48
   // handle input/output configuration (smoke detector)
   if (_port_layout == PORT_LAYOUT_IO_48)
   {    
     // configure outline
-    _layout_config.x = 0;
-    _layout_config.y = 137;
-    _layout_config.xo = 10;
-    _layout_config.bw = 27;
-    _layout_config.bh = 33;
-    _layout_config.index_max = 48;
-    // draw outline as configured   
-    for (int index = 1; index <= _layout_config.index_max; index += 16)
-    {
-      for (int i = 0; i < 16; i++)
-      {
-        if (index <= 16)
-        {
-          _update_io_48(TYPE_FRAME, index+i, 1);
-        }
-        _update_io_48(TYPE_STATE, index+i, 0);
-      }
-      mcps_found >>= 1;
-    }  
+    config.x = 0;
+    config.y = 137;
+    config.xo = 10;
+    config.bw = 27;
+    config.bh = 33;
+    config.index_max = 48;
+    _layout_config_in = config;
+    _build_input_cells(true);
   }
+#endif
 
   // handle hybrid configurations
   if (_getPortLayoutGroup(_port_layout) == PORT_LAYOUT_GROUP_HYBRID)
@@ -401,131 +855,173 @@ void OXRS_LCD::drawPorts(int port_layout, uint8_t mcps_found)
     {
       case PORT_LAYOUT_IO_32_96:
       case PORT_LAYOUT_IO_32_96_8:
-        _layout_config.x = 0;
-        _layout_config.y = 115;
-        _layout_config.xo = 25+47;
-        _layout_config.bw = 23;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 32;
+        config.x = 0;
+        config.y = 115;
+        config.xo = 25+47;
+        config.bw = 23;
+        config.bh = 19;
+        config.index_max = 32;
         break;
       case PORT_LAYOUT_IO_64_64:
       case PORT_LAYOUT_IO_64_64_8:
-        _layout_config.x = 0;
-        _layout_config.y = 115;
-        _layout_config.xo = 25; 
-        _layout_config.bw = 23;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 64;
+        config.x = 0;
+        config.y = 115;
+        config.xo = 25; 
+        config.bw = 23;
+        config.bh = 19;
+        config.index_max = 64;
         break;
       case PORT_LAYOUT_IO_96_32:
       case PORT_LAYOUT_IO_96_32_8:
-        _layout_config.x = 0;
-        _layout_config.y = 115;
-        _layout_config.xo = 2; 
-        _layout_config.bw = 19;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 96;
+        config.x = 0;
+        config.y = 115;
+        config.xo = 2; 
+        config.bw = 19;
+        config.bh = 19;
+        config.index_max = 96;
         break;
     }
-    _layout_config_in = _layout_config;
-    
-    // draw outline as configured
-    for (int index = 1; index <= _layout_config.index_max; index += 16)
-    {
-      int state = (bitRead(mcps_found, 0)) ? PORT_STATE_OFF : PORT_STATE_NA;
-      for (int i = 0; i < 16; i++)
-      {
-        if ((i % 4) == 0)
-        {
-          _update_input(TYPE_FRAME, index+i, state);
-        }
-        _update_input(TYPE_STATE, index+i, state);
-      }
-      mcps_found >>= 1;
-    }
+    _layout_config_in = config;
+    _build_input_cells(_port_layout == PORT_LAYOUT_IO_96_32 || _port_layout == PORT_LAYOUT_IO_96_32_8);
 
     // configure outline output ports
     switch (_port_layout) 
     {
       case PORT_LAYOUT_IO_32_96:
-        _layout_config.x = 0;
-        _layout_config.y = 158;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 96;
-        frame_h = _layout_config.bh * 3 + 8;
+        config.x = 0;
+        config.y = 158;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 96;
+        frame_h = config.bh * 3 + 8;
         _mcp_output_start = 2;
         break;
       case PORT_LAYOUT_IO_64_64:
-        _layout_config.x = 0;
-        _layout_config.y = 168;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 64;
-        frame_h = _layout_config.bh * 2 + 6;
+        config.x = 0;
+        config.y = 168;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 64;
+        frame_h = config.bh * 2 + 6;
         _mcp_output_start = 4;
         break;
       case PORT_LAYOUT_IO_96_32:
-        _layout_config.x = 0;
-        _layout_config.y = 178;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 32;
-        frame_h = _layout_config.bh + 4;
+        config.x = 0;
+        config.y = 178;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 32;
+        frame_h = config.bh + 4;
         _mcp_output_start = 6;
         break;
         
       case PORT_LAYOUT_IO_32_96_8:
-        _layout_config.x = 0;
-        _layout_config.y = 168;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 64;
-        frame_h = _layout_config.bh * 2 + 6;
+        config.x = 0;
+        config.y = 168;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 64;
+        frame_h = config.bh * 2 + 6;
         _mcp_output_start = 2;
         break;
       case PORT_LAYOUT_IO_64_64_8:
-        _layout_config.x = 0;
-        _layout_config.y = 178;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 32;
-        frame_h = _layout_config.bh + 4;
+        config.x = 0;
+        config.y = 178;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 32;
+        frame_h = config.bh + 4;
         _mcp_output_start = 4;
         break;
       case PORT_LAYOUT_IO_96_32_8:
-        _layout_config.x = 0;
-        _layout_config.y = 178;
-        _layout_config.xo = 4;
-        _layout_config.bw = 8;
-        _layout_config.bh = 19;
-        _layout_config.index_max = 32;
-        frame_h = _layout_config.bh + 4;
+        config.x = 0;
+        config.y = 178;
+        config.xo = 4;
+        config.bw = 8;
+        config.bh = 19;
+        config.index_max = 32;
+        frame_h = config.bh + 4;
         _mcp_output_start = 6;
         break;
     }
-    _layout_config_out = _layout_config;
-    
-    // draw outline as configured   
-    tft.fillRect(0, _layout_config.y-2, 240, frame_h,  TFT_WHITE);
-    for (int index = 1; index <= _layout_config.index_max; index += _mcp_output_pins)
+    _layout_config_out = config;
+    _build_output_cells();
+  }
+
+  // one slice per MCP block of ports, the outputs after the inputs (an MCP
+  // each, from bit 0 of mcps_found on), and the event bar
+  _ports_mcps_found = mcps_found;
+  _ports_deferred = 0;
+  _ports_frame_h = frame_h;
+  _ports_in_blocks = _layout_config_in.index_max / 16;
+  _ports_slices = _ports_in_blocks + 1;
+  if (_layout_config_out.index_max)
+  {
+    _ports_slices += _layout_config_out.index_max / _mcp_output_pins;
+  }
+  _ports_slice = 0;
+}
+
+// the next slice of drawPorts(), queued (the last one flushes)
+void OXRS_LCD::_draw_ports_slice(void)
+{
+  int slice = _ports_slice++;
+
+  // draw outline as configured
+  if (slice < _ports_in_blocks)
+  {
+    int index = slice * 16 + 1;
+#ifndef OXRS_LCD_NO_IO_48
+    if (_port_layout == PORT_LAYOUT_IO_48)
+    {
+      for (int i = 0; i < 16; i++)
+      {
+        if (index <= 16)
+        {
+          _update_io_48(TYPE_FRAME, index+i, 1);
+        }
+        _update_io_48(TYPE_STATE, index+i, 0);
+      }
+      return;
+    }
+#endif
+    int state = (bitRead(_ports_mcps_found, slice)) ? PORT_STATE_OFF : PORT_STATE_NA;
+    for (int i = 0; i < 16; i++)
     {
-      int state = (bitRead(mcps_found, 0)) ? PORT_STATE_OFF : PORT_STATE_NA;
-      for (int i = 0; i < _mcp_output_pins; i++)
+      if ((i % 4) == 0)
       {
-        _update_output(TYPE_FRAME, index+i, state);
-        _update_output(TYPE_STATE, index+i, state);
+        _update_input(TYPE_FRAME, index+i, state);
       }
-      mcps_found >>= 1;
+      _update_input(TYPE_STATE, index+i, state);
     }
+    return;
   }
 
-  // fill bottom field with gray (event display space)
+  if (slice < _ports_slices - 1)
+  {
+    int block = slice - _ports_in_blocks;
+    int index = block * _mcp_output_pins + 1;
+    if (block == 0)
+    {
+      _draw(DRAW_FILL_RECT, 0, _layout_config_out.y-2, 240, _ports_frame_h, 0, TFT_WHITE);
+    }
+    int state = (bitRead(_ports_mcps_found, slice)) ? PORT_STATE_OFF : PORT_STATE_NA;
+    for (int i = 0; i < _mcp_output_pins; i++)
+    {
+      _update_output(TYPE_FRAME, index+i, state);
+      _update_output(TYPE_STATE, index+i, state);
+    }
+    return;
+  }
+
+  _flush_draws();
+
+  // fill bottom field with gray (event display space)
   _clear_event();
 }
 
@@ -536,17 +1032,53 @@ void OXRS_LCD::drawPorts(int port_layout, uint8_t mcps_found)
  */
 void OXRS_LCD::process(uint8_t mcp, uint16_t io_value)
 {
-  int i, index;
+  if (_queue_process(mcp, io_value)) return;
+  _process(mcp, io_value);
+}
+
+void OXRS_LCD::_process(uint8_t mcp, uint16_t io_value)
+{
+  LCD_TRACE_SCOPE("process");
+  render_stat_scope stat(_render_stats.process);
+  write_scope write(*this);
+
+  int index, pin_count;
+  bool forced;
+  uint32_t seen_us;
+  uint16_t changed = _process_begin(mcp, io_value, index, pin_count, forced, seen_us);
+  if (!changed) return;
+
+  int queued = (this->*_process_pins_fn)(mcp, changed, io_value, index, pin_count);
+  _process_end(mcp, io_value, queued, forced, seen_us);
+}
+
+/*
+ * the parts of process() around the pins :
+ * the pins of mcp that changed (0 for none), the index of its first pin and
+ * how many it has. forced is set for the first io_value of an MCP (all pins
+ * are painted, they are not changes), seen_us when the changes were seen
+ */
+uint16_t OXRS_LCD::_process_begin(uint8_t mcp, uint16_t io_value, int& index, int& pin_count, bool& forced, uint32_t& seen_us)
+{
   uint16_t changed;
-  int pin_count;
+  forced = false;
   
   // nothing to do if MCP wasn't found
-  if (!bitRead(_mcps_found, mcp)) return;
+  if (!bitRead(_mcps_found, mcp)) return 0;
+
+  // painted once drawn, see startDrawPorts
+  if (_ports_slice < _ports_slices)
+  {
+    _io_values[mcp] = io_value;
+    bitSet(_ports_deferred, mcp);
+    return 0;
+  }
    
   // check if io_values initialised, if not -> force display update
   if (!bitRead(_mcps_initialised, mcp))
   {
     changed = 0xffff;
+    forced = true;
     bitSet(_mcps_initialised, mcp);
   }
   // Compare with last stored value
@@ -554,134 +1086,106 @@ void OXRS_LCD::process(uint8_t mcp, uint16_t io_value)
   {
     changed = io_value ^ _io_values[mcp];
   }
-  
+  if (!changed) return 0;
+
+  // pin changes seen, for the latency until each is painted (from the
+  // firmware side's process() with the render queue)
+  seen_us = _draining ? _draining_us : micros();
+
+  _record(mcp, 0, &io_value, 1);
+
+  if (!forced) _diag_changes[mcp] += __builtin_popcount(changed);
+
   // figure out index and pin_count
-  if (changed)
+  if (_mcp_output_start > 7)
+  // no splitted configuration
+  {
+    index = mcp * _mcp_output_pins;
+    pin_count = _mcp_output_pins;
+  }
+  else
   {
-    if (_mcp_output_start > 7)
-    // no splitted configuration
+    if (mcp < _mcp_output_start)
+    // input mcps (16 pins)
     {
-      index = mcp * _mcp_output_pins;
-      pin_count = _mcp_output_pins;
+      index = mcp * 16;
+      pin_count = 16;
     }
     else
+    // output mcps / handle 8/16
     {
-      if (mcp < _mcp_output_start)
-      // input mcps (16 pins)
-      {
-        index = mcp * 16;
-        pin_count = 16;
-      }
-      else
-      // output mcps / handle 8/16
-      {
-         index = _mcp_output_start * 16 + (mcp - _mcp_output_start) * _mcp_output_pins;
-         pin_count = _mcp_output_pins;
-      }
+       index = _mcp_output_start * 16 + (mcp - _mcp_output_start) * _mcp_output_pins;
+       pin_count = _mcp_output_pins;
     }
+  }
+  return changed;
+}
 
-    // walk thru all inputs, call _update_... if change detected
-    for (i = 0; i < pin_count; i++)
-    {
-      // skip if nothing has changed
-      if (!bitRead(changed, i)) continue;
+void OXRS_LCD::_process_end(uint8_t mcp, uint16_t io_value, int queued, bool forced, uint32_t seen_us)
+{
+  // the changes are on the display once loop() flushes the draws,
+  // forced updates are not pin changes
+  if (!forced)
+  {
+    if (!_latency_pending[mcp]) _latency_seen_us[mcp] = seen_us;
+    _latency_pending[mcp] += queued;
+  }
 
-      // get the port configuration
-      int port = (index + i) / 4;
-      int pin_type = bitRead(_pin_type[mcp], i);
-      int pin_invert = bitRead(_pin_invert[mcp], i);
-      int pin_disabled = bitRead(_pin_disabled[mcp], i);
+  // Need to store so we can detect changes for port animation
+  _io_values[mcp] = io_value;
+}
 
-      // read the pin value (inverting if required)
-      int pin_value = bitRead(io_value, i) ^ pin_invert;
+/*
+ * one changed pin per layout group, index is the (0-based) index of pin 0 of mcp
+ */
+void OXRS_LCD::_pin_input(uint8_t mcp, int index, int pin, uint16_t io_value)
+{
+  if (bitRead(_pin_type[mcp], pin) == PIN_TYPE_SECURITY)
+  {
+    _schedule_security((index + pin) / 4, (io_value >> (pin & 0xfc)) & 0x000f); 
+  }
+  else if (bitRead(_pin_disabled[mcp], pin))
+  {
+    _schedule_input(index+pin+1, PORT_STATE_DISABLED);
+  }
+  else
+  {
+    int pin_value = bitRead(io_value, pin) ^ bitRead(_pin_invert[mcp], pin);
+    _schedule_input(index+pin+1, pin_value ? PORT_STATE_OFF : PORT_STATE_ON);
+  }
+}
 
-      // only update the backlight if an active pin has changed
-      if (!pin_disabled)
-      {
-        _set_backlight(_brightness_on);
-        _last_lcd_trigger = millis();
-      }
-      
-      switch (_port_layout) 
-      {
-        // input ports
-        case PORT_LAYOUT_INPUT_32:
-        case PORT_LAYOUT_INPUT_64:
-        case PORT_LAYOUT_INPUT_96:
-        case PORT_LAYOUT_INPUT_128:
-          if (pin_type == PIN_TYPE_SECURITY)
-          {
-            _update_security(TYPE_STATE, port, (io_value >> (i & 0xfc)) & 0x000f); 
-          }
-          else
-          {
-            if (pin_disabled)
-            {
-              _update_input(TYPE_STATE, index+i+1, PORT_STATE_DISABLED);
-            }
-            else
-            {
-              _update_input(TYPE_STATE, index+i+1, pin_value ? PORT_STATE_OFF : PORT_STATE_ON);
-            }
-          }
-          break;
-        // outport ports
-        case PORT_LAYOUT_OUTPUT_32:
-        case PORT_LAYOUT_OUTPUT_64:
-        case PORT_LAYOUT_OUTPUT_96:
-        case PORT_LAYOUT_OUTPUT_128:
-        case PORT_LAYOUT_OUTPUT_32_8:
-        case PORT_LAYOUT_OUTPUT_64_8:
-          _update_output(TYPE_STATE, index+i+1, pin_value ? PORT_STATE_ON : PORT_STATE_OFF); 
-          break;
-        // input and output ports mixed
-        case PORT_LAYOUT_IO_48:
-          if (index < 16)
-          {
-            _update_io_48(TYPE_STATE, index+i+1, pin_value ? PORT_STATE_OFF : PORT_STATE_ON);
-          } 
-          else
-          {
-            _update_io_48(TYPE_STATE, index+i+1, pin_value ? PORT_STATE_ON : PORT_STATE_OFF);
-          }
-          break;
-        // hybrid ports
-        case PORT_LAYOUT_IO_32_96:
-        case PORT_LAYOUT_IO_64_64:
-        case PORT_LAYOUT_IO_96_32:
-        case PORT_LAYOUT_IO_32_96_8:
-        case PORT_LAYOUT_IO_64_64_8:
-        case PORT_LAYOUT_IO_96_32_8:
-          if ((index+i+1) <= _layout_config_in.index_max)
-          {
-            _layout_config = _layout_config_in;
-            if (pin_type == PIN_TYPE_SECURITY)
-            {
-              _update_security(TYPE_STATE, port, (io_value >> (i & 0xfc)) & 0x000f); 
-            }
-            else
-            {
-              if (pin_disabled)
-              {
-                _update_input(TYPE_STATE, index+i+1, PORT_STATE_DISABLED);
-              }
-              else
-              {
-                _update_input(TYPE_STATE, index+i+1, pin_value ? PORT_STATE_OFF : PORT_STATE_ON);
-              }
-            }
-          }
-          else
-          {
-            _layout_config = _layout_config_out;
-            _update_output(TYPE_STATE, (index+i+1) - _layout_config_in.index_max, pin_value ? PORT_STATE_ON : PORT_STATE_OFF); 
-          }
-          break;
-      }
-    }
+void OXRS_LCD::_pin_output(uint8_t mcp, int index, int pin, uint16_t io_value)
+{
+  int pin_value = bitRead(io_value, pin) ^ bitRead(_pin_invert[mcp], pin);
+  _schedule_output(index+pin+1, pin_value ? PORT_STATE_ON : PORT_STATE_OFF); 
+}
 
-    // Need to store so we can detect changes for port animation
-    _io_values[mcp] = io_value;
+#ifndef OXRS_LCD_NO_IO_48
+void OXRS_LCD::_pin_io_48(uint8_t mcp, int index, int pin, uint16_t io_value)
+{
+  int pin_value = bitRead(io_value, pin) ^ bitRead(_pin_invert[mcp], pin);
+  if (index < 16)
+  {
+    _schedule_io_48(index+pin+1, pin_value ? PORT_STATE_OFF : PORT_STATE_ON);
+  } 
+  else
+  {
+    _schedule_io_48(index+pin+1, pin_value ? PORT_STATE_ON : PORT_STATE_OFF);
+  }
+}
+#endif
+
+void OXRS_LCD::_pin_hybrid(uint8_t mcp, int index, int pin, uint16_t io_value)
+{
+  if ((index+pin+1) <= _layout_config_in.index_max)
+  {
+    _pin_input(mcp, index, pin, io_value);
+  }
+  else
+  {
+    int pin_value = bitRead(io_value, pin) ^ bitRead(_pin_invert[mcp], pin);
+    _schedule_output((index+pin+1) - _layout_config_in.index_max, pin_value ? PORT_STATE_ON : PORT_STATE_OFF); 
   }
 }
 
@@ -695,12 +1199,39 @@ void OXRS_LCD::process(uint8_t mcp, uint16_t io_value)
  */
 void OXRS_LCD::loop(void)
 {
+  // the render side does the rest, Ethernet, WiFi and MQTT are polled here
+  if (_queue_on)
+  {
+    _post_link();
+    _post_overflow();
+    return;
+  }
+  _loop();
+}
+
+void OXRS_LCD::_loop(void)
+{
+  LCD_TRACE_SCOPE("loop");
+  render_stat_scope stat(_render_stats.loop);
+  uint32_t start_us = micros();
+
+  // the screen of startDrawHeader()/startDrawPorts() first
+  if (!_screen_drawn() && !_draw_slices(start_us))
+  {
+    _check_diagnostics(micros() - start_us);
+    return;
+  }
+
+  // the timers and the link before the LEDs, they cost little and a storm of
+  // pin changes cannot hold them up (the rx/tx and event paints they leave
+  // pending wait behind the LEDs)
+
   // Clear event display if timed out
   if (_ontime_event_ms && _last_event_display)
   {
     if ((millis() - _last_event_display) > _ontime_event_ms)
     {
-      _clear_event();      
+      _schedule_event_clear();
       _last_event_display = 0L;
     }
   }
@@ -720,7 +1251,7 @@ void OXRS_LCD::loop(void)
   {
     if ((millis() - _last_rx_trigger) > RX_TX_LED_ON)
     {
-      _set_mqtt_rx_led(MQTT_STATE_UP);
+      _schedule_rx_led(MQTT_STATE_UP);
       _last_rx_trigger = 0L;
     }
   }
@@ -730,17 +1261,35 @@ void OXRS_LCD::loop(void)
   {
     if ((millis() - _last_tx_trigger) > RX_TX_LED_ON)
     {
-      _set_mqtt_tx_led(MQTT_STATE_UP);
+      _schedule_tx_led(MQTT_STATE_UP);
       _last_tx_trigger = 0L;
     }
   }
  
-  // check if IP or MQTT state has changed
-  _check_IP_state(_get_IP_state());
-  _check_MQTT_state(_get_MQTT_state());
+  // check if IP or MQTT state has changed (not while the diagnostics page covers them)
+  if (!_diag_shown)
+  {
+    _check_IP_state(_queue_on ? _queued_ip_state : _get_IP_state());
+    _check_MQTT_state(_queue_on ? _queued_mqtt_state : _get_MQTT_state());
+  }
+
+  // LEDs left pending by process(), the flashing only with none left and
+  // time to spare (see setRenderBudget)
+  if (_scheduled() && !_schedule(start_us))
+  {
+    _check_diagnostics(micros() - start_us);
+    return;
+  }
+
+  // flash timer on / off and what process() and the flash timer queued, in
+  // one SPI transaction
+  {
+    write_scope write(*this);
+    _check_port_flash();    
+    _flush_draws();
+  }
 
-  // flash timer on / off
-  _check_port_flash();    
+  _check_diagnostics(micros() - start_us);
 }
 
 /*
@@ -748,13 +1297,33 @@ void OXRS_LCD::loop(void)
  */
 void OXRS_LCD::triggerMqttRxLed(void)
 {
-  _set_mqtt_rx_led(MQTT_STATE_ACTIVE);
-  _last_rx_trigger = millis(); 
+  if (_queue_on)
+  {
+    _post(RECORD_MQTT_RX);
+    return;
+  }
+  _trigger_mqtt_rx_led();
 }
 
 void OXRS_LCD::triggerMqttTxLed(void)
 {
-  _set_mqtt_tx_led(MQTT_STATE_ACTIVE);
+  if (_queue_on)
+  {
+    _post(RECORD_MQTT_TX);
+    return;
+  }
+  _trigger_mqtt_tx_led();
+}
+
+void OXRS_LCD::_trigger_mqtt_rx_led(void)
+{
+  _schedule_rx_led(MQTT_STATE_ACTIVE);
+  _last_rx_trigger = millis(); 
+}
+
+void OXRS_LCD::_trigger_mqtt_tx_led(void)
+{
+  _schedule_tx_led(MQTT_STATE_ACTIVE);
   _last_tx_trigger = millis(); 
 }
 
@@ -764,10 +1333,23 @@ void OXRS_LCD::hideTemp(void)
 }
 
 void OXRS_LCD::showTemp(float temperature, char unit)
+{
+  if (_queue_on)
+  {
+    _post(RECORD_TEMP, unit, isnan(temperature) ? RECORD_TEMP_NAN : (uint16_t)(int16_t)lroundf(temperature * 10));
+    return;
+  }
+  _show_temp(temperature, unit);
+}
+
+void OXRS_LCD::_show_temp(float temperature, char unit)
 {
   char buffer[30];
   
-  if (_yTEMP == 0) return;
+  _temperature = temperature;
+  _temperature_unit = unit;
+
+  if (_yTEMP == 0 || _diag_shown) return;
  
   tft.fillRect(0, _yTEMP, 240, 13,  TFT_BLACK);
   if (!isnan(temperature))
@@ -785,11 +1367,48 @@ void OXRS_LCD::showTemp(float temperature, char unit)
  */
 void OXRS_LCD::showEvent(const char * s_event, int font)
 {
+  if (_queue_on)
+  {
+    // the text goes into the event ring, taken from there by its record. with
+    // no room for both the event is dropped
+    lcd_event_text event;
+    strncpy(event.text, s_event, sizeof(event.text) - 1);
+    event.text[sizeof(event.text) - 1] = 0;
+
+    _post_overflow();
+    if (!_overflow_mcps && _queue->records.space() && _queue->events.push(event))
+    {
+      _post(RECORD_EVENT, 0, font);
+    }
+    else
+    {
+      _queue_dropped++;
+    }
+    return;
+  }
+  _schedule_event(s_event, font);
+}
+
+void OXRS_LCD::_show_event(const char * s_event, int font)
+{
+  LCD_TRACE_SCOPE("showEvent");
+
   // Show last input event on bottom line
   tft.fillRect(0, 223, 240, 17,  TFT_WHITE);
   tft.setTextColor(TFT_BLACK, TFT_WHITE);
   tft.setTextDatum(TL_DATUM);
+#if !defined(OXRS_LCD_NO_FONT_MONO) && !defined(OXRS_LCD_NO_FONT_PROP)
   tft.setFreeFont(font != FONT_MONO ? FSSB9 : FMB9);
+#elif !defined(OXRS_LCD_NO_FONT_MONO)
+  (void)font;
+  tft.setFreeFont(FMB9);
+#elif !defined(OXRS_LCD_NO_FONT_PROP)
+  (void)font;
+  tft.setFreeFont(FSSB9);
+#else
+  (void)font;
+  tft.setFreeFont(&Roboto_Mono_Thin_13);
+#endif
   tft.drawString(s_event, 2, 224);
   tft.setTextColor(TFT_WHITE, TFT_BLACK);
   _last_event_display = millis(); 
@@ -800,19 +1419,154 @@ void OXRS_LCD::_clear_event()
   tft.fillRect(0, 223, 240, 240,  TFT_DARKGREY);
 }
 
+/*
+ * diagnostics page :
+ * takes the place of the info section (IP, MAC, MQTT, TEMP) so the ports stay live
+ *
+ *   LOOP  1234/s max  5678us      loop() rate and longest loop()
+ *   SPI    12%   FLASH  3         bus load of the port painters, flashing security ports
+ *   CHG0    0    0    0    0      pin changes per second of MCP 0..3
+ *   CHG4    0    0    0    0      pin changes per second of MCP 4..7
+ *
+ * the SPI load is estimated from the time spent drawing the ports, TFT_eSPI
+ * blocks until its writes are on the bus so that is mostly bus time
+ */
+void OXRS_LCD::showDiagnostics(bool show)
+{
+  if (_queue_on)
+  {
+    _post(RECORD_DIAGNOSTICS, 0, show);
+    return;
+  }
+  _show_diagnostics(show);
+}
+
+void OXRS_LCD::_show_diagnostics(bool show)
+{
+  if (show == _diag_shown) return;
+  _diag_shown = show;
+
+  tft.fillRect(0, Y_INFO, 240, DIAG_H, TFT_BLACK);
+
+  if (_diag_shown)
+  {
+    tft.setTextColor(TFT_WHITE);
+    tft.setTextDatum(TL_DATUM);
+    tft.setFreeFont(&Roboto_Mono_Thin_13);
+    tft.drawString("LOOP", 12, Y_INFO);
+    tft.drawString("/s max", 12 + 10*9, Y_INFO);
+    tft.drawString("us", 12 + 23*9, Y_INFO);
+    tft.drawString("SPI", 12, Y_INFO + 15);
+    tft.drawString("%", 12 + 10*9, Y_INFO + 15);
+    tft.drawString("FLASH", 12 + 13*9, Y_INFO + 15);
+    tft.drawString("CHG0", 12, Y_INFO + 30);
+    tft.drawString("CHG4", 12, Y_INFO + 45);
+
+    // nothing drawn yet, every value differs from this
+    memset(&_diag_drawn, 0xff, sizeof(_diag_drawn));
+    _draw_diagnostics();
+  }
+  else
+  {
+    // force the info section to be drawn again
+    _ip_state = -1;
+    _mqtt_state = -1;
+    if (!isnan(_temperature)) _show_temp(_temperature, _temperature_unit);
+  }
+}
+
+bool OXRS_LCD::diagnosticsShown(void)
+{
+  if (_queue_on) return _shown_diagnostics.load(std::memory_order_relaxed);
+  return _diag_shown;
+}
+
+void OXRS_LCD::_check_diagnostics(uint32_t loop_us)
+{
+  _diag_loops++;
+  if (loop_us > _diag_loop_max_us) _diag_loop_max_us = loop_us;
+
+  uint32_t window_ms = millis() - _diag_window_start;
+  if (window_ms < DIAG_WINDOW_MS) return;
+
+  // port draw time since the start of the window (resetRenderStats() may have cleared it)
+  uint32_t busy_us = _render_stats.flush_draws.total_us;
+  uint32_t window_busy_us = (busy_us >= _diag_busy_us) ? busy_us - _diag_busy_us : busy_us;
+
+  _diag_values.loop_hz = (uint64_t)_diag_loops * 1000 / window_ms;
+  _diag_values.loop_max_us = _diag_loop_max_us;
+  _diag_values.spi_pct = (uint64_t)window_busy_us / 10 / window_ms;
+  if (_diag_values.spi_pct > 100) _diag_values.spi_pct = 100;
+  _diag_values.flashing = __builtin_popcount(_ports_to_flash);
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    _diag_values.changes[mcp] = (uint64_t)_diag_changes[mcp] * 1000 / window_ms;
+    _diag_changes[mcp] = 0;
+  }
+
+  _diag_window_start = millis();
+  _diag_loops = 0;
+  _diag_loop_max_us = 0;
+  _diag_busy_us = busy_us;
+
+  if (_diag_shown) _draw_diagnostics();
+}
+
+// only the values that changed since they were last drawn
+void OXRS_LCD::_draw_diagnostics(void)
+{
+  _draw_diag_value(5, 0, 5, _diag_values.loop_hz, _diag_drawn.loop_hz);
+  _draw_diag_value(17, 0, 6, _diag_values.loop_max_us, _diag_drawn.loop_max_us);
+  _draw_diag_value(7, 1, 3, _diag_values.spi_pct, _diag_drawn.spi_pct);
+  _draw_diag_value(19, 1, 2, _diag_values.flashing, _diag_drawn.flashing);
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    _draw_diag_value(5 + (mcp % 4) * 5, 2 + mcp / 4, 4, _diag_values.changes[mcp], _diag_drawn.changes[mcp]);
+  }
+}
+
+// right aligned in a field of width characters at a column of the mono font
+void OXRS_LCD::_draw_diag_value(int col, int row, int width, uint32_t value, uint32_t& drawn)
+{
+  if (value == drawn) return;
+  drawn = value;
+
+  int x = 12 + col * 9;
+  int y = Y_INFO + row * 15;
+
+  char buffer[12];
+  sprintf(buffer, "%*lu", width, (unsigned long)value);
+  if ((int)strlen(buffer) > width)
+  // saturate rather than overrun the field
+  {
+    memset(buffer, '9', width);
+    buffer[width] = 0;
+  }
+
+  tft.fillRect(x, y, width * 9, 13, TFT_BLACK);
+  tft.setTextColor(TFT_WHITE);
+  tft.setTextDatum(TL_DATUM);
+  tft.setFreeFont(&Roboto_Mono_Thin_13);
+  tft.drawString(buffer, x, y);
+}
+
 byte * OXRS_LCD::_get_MAC_address(byte * mac)
 {
+#ifndef OXRS_LCD_NO_ETHERNET
   if (_ethernet)
   {
     _ethernet->MACAddress(mac);
     return mac;
   }
+#endif
 
+#ifndef OXRS_LCD_NO_WIFI
   if (_wifi)
   {
     _wifi->macAddress(mac);
     return mac;
   }
+#endif
   
   memset(mac, 0, 6);
   return mac;
@@ -822,15 +1576,19 @@ IPAddress OXRS_LCD::_get_IP_address(void)
 {
   if (_get_IP_state() == IP_STATE_UP)
   {
+#ifndef OXRS_LCD_NO_ETHERNET
     if (_ethernet)
     {
       return _ethernet->localIP();
     }
+#endif
 
+#ifndef OXRS_LCD_NO_WIFI
     if (_wifi)
     {
       return _wifi->localIP();
     }
+#endif
   }
   
   return IPAddress(0, 0, 0, 0);
@@ -838,32 +1596,38 @@ IPAddress OXRS_LCD::_get_IP_address(void)
 
 int OXRS_LCD::_get_IP_state(void)
 {
+#ifndef OXRS_LCD_NO_ETHERNET
   if (_ethernet)
   {
     return _ethernet->linkStatus() == LinkON ? IP_STATE_UP : IP_STATE_DOWN;
   }
+#endif
   
+#ifndef OXRS_LCD_NO_WIFI
   if (_wifi)
   {
     return _wifi->status() == WL_CONNECTED ? IP_STATE_UP : IP_STATE_DOWN;
   }
+#endif
 
   return IP_STATE_UNKNOWN;
 }
 
 void OXRS_LCD::_check_IP_state(int state)
 {
+  LCD_TRACE_SCOPE("_check_IP_state");
+
   if (state != _ip_state)
   {
     _ip_state = state;
 
-    // refresh IP address on state change
-    IPAddress ip = _get_IP_address();
+    // refresh IP address on state change (as loop() read it with the queue on)
+    IPAddress ip = _queue_on ? IPAddress(_queue->link.ip[0], _queue->link.ip[1], _queue->link.ip[2], _queue->link.ip[3]) : _get_IP_address();
     _show_IP(ip);
 
     // refresh MAC on state change
     byte mac[6];
-    _show_MAC(_get_MAC_address(mac));
+    _show_MAC(_queue_on ? _queue->link.mac : _get_MAC_address(mac));
 
     // update the link LED after refreshing IP address
     // since that clears that whole line on the screen
@@ -900,15 +1664,19 @@ void OXRS_LCD::_show_IP(IPAddress ip)
   }
   tft.drawString(buffer, 12, _yIP);
   
+#ifndef OXRS_LCD_NO_ETHERNET
   if (_ethernet)
   {
     tft.drawBitmap(13, _yIP+1, icon_ethernet, 11, 10, TFT_BLACK, TFT_WHITE);
   }
+#endif
 
+#ifndef OXRS_LCD_NO_WIFI
   if (_wifi)
   {
     tft.drawBitmap(13, _yIP+1, icon_wifi, 11, 10, TFT_BLACK, TFT_WHITE);
   }
+#endif
 }
 
 void OXRS_LCD::_show_MAC(byte mac[])
@@ -939,6 +1707,8 @@ int OXRS_LCD::_get_MQTT_state(void)
 
 void OXRS_LCD::_check_MQTT_state(int state)
 {
+  LCD_TRACE_SCOPE("_check_MQTT_state");
+
   if (state != _mqtt_state)
   {
     _mqtt_state = state;
@@ -951,11 +1721,13 @@ void OXRS_LCD::_check_MQTT_state(int state)
     else
     {
       char topic[64];
-      _show_MQTT_topic(_mqtt->getWildcardTopic(topic));
+      _show_MQTT_topic(_queue_on ? _queue->link.topic : _mqtt->getWildcardTopic(topic));
     }
 
     // update the activity LEDs after refreshing MQTT topic
     // since that clears that whole line on the screen
+    bitClear(_pending_status, PENDING_RX_LED);
+    bitClear(_pending_status, PENDING_TX_LED);
     _set_mqtt_tx_led(_mqtt_state);
     _set_mqtt_rx_led(_mqtt_state);
     
@@ -984,14 +1756,12 @@ void OXRS_LCD::_show_MQTT_topic(const char * topic)
 
 void OXRS_LCD::_check_port_flash(void)
 {
+  LCD_TRACE_SCOPE("_check_port_flash");
+  write_scope write(*this);
+
   if ((millis() - _last_flash_trigger) > _flash_timer_ms)
   {
     _flash_on = !_flash_on;
-    // handle hybrid configurations
-    if (_getPortLayoutGroup(_port_layout) == PORT_LAYOUT_GROUP_HYBRID)
-    {
-      _layout_config = _layout_config_in;
-    }
 
     for (int port = 0; port < 32; port++)
     {
@@ -1014,19 +1784,6 @@ void OXRS_LCD::_check_port_flash(void)
 }
 
 // return the actual layout group from port_layout
-int OXRS_LCD::_getPortLayoutGroup(int port_layout)
-{
-  int group = 0;
-  switch (port_layout / 1000)
-  {
-    case 1: group = PORT_LAYOUT_GROUP_INPUT; break;
-    case 2: group = PORT_LAYOUT_GROUP_OUTPUT; break;
-    case 3: group = PORT_LAYOUT_GROUP_SMOKE; break;
-    case 4: group = PORT_LAYOUT_GROUP_HYBRID; break;
-  }
-  return group;
-}
-
 /**
   animation of input state in ports view
   Ports:    | 1 | 3 | 5 | 7 |     Index:      | 1 : 3 | 9 : 11|
@@ -1037,162 +1794,1362 @@ int OXRS_LCD::_getPortLayoutGroup(int port_layout)
                                               |.......|.......|
                                               | 6 : 8 | 14: 16|                                             
 */
-void OXRS_LCD::_update_input(uint8_t type, uint8_t index, int state)
+/*
+ * SPI transaction over a pass that paints, see write_scope
+ */
+void OXRS_LCD::_write_open(void)
 {
-  // OFF, ON, NA, DISABLED
-  uint16_t color_map[4] = {TFT_DARKGREY, TFT_YELLOW, tft.color565(60,60,60), TFT_BLACK};
-  
-  int bw =  _layout_config.bw;
-  int bh =  _layout_config.bh;
-  int xo =  _layout_config.xo;
-  int x =   _layout_config.x;
-  int y =   _layout_config.y;
-  int port;
-  uint16_t color;
+  if (_writing) return;
+  tft.startWrite();
+  _writing = true;
+}
 
-  if (index > _layout_config.index_max) return;
-  
-  index -= 1;
-  port = index / 4;
-  
-  y = y + (port % 2) * bh;
-  if (    _port_layout == PORT_LAYOUT_INPUT_96 
-      ||  _port_layout == PORT_LAYOUT_IO_96_32 
-      ||  _port_layout == PORT_LAYOUT_IO_96_32_8 )
-  {
-    xo = xo + (port / 8) * 3;
-    x = xo + (port / 2) * bw;
-  }
-  else
+void OXRS_LCD::_write_end(void)
+{
+  if (--_write_depth || !_writing) return;
+  if (_transport) _transport->wait();
+  tft.endWrite();
+  _writing = false;
+}
+
+/*
+ * deferred port drawing :
+ * the painters queue their primitives, commands painted over by a later one
+ * are dropped and the damaged areas are merged (see OXRS_LCD_draw_list.h).
+ * loop() flushes once per call, drawPorts() at its end, a full list at once.
+ */
+void OXRS_LCD::_draw(uint8_t kind, int x, int y, int w, int h, int r, uint16_t color)
+{
+  if (_draws.add(kind, x, y, w, h, r, color)) return;
+
+  _flush_draws();
+  if (_draws.add(kind, x, y, w, h, r, color)) return;
+
+  // no list (before begin() or out of memory), straight to the display
+  draw_cmd cmd = {kind, (uint8_t)r, (int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h, color};
+  write_scope write(*this);
+  _write_open();
+  _draw_cmd(cmd);
+}
+
+void OXRS_LCD::_draw_cmd(const draw_cmd& cmd)
+{
+  switch (cmd.kind)
   {
-    if (port > 15) {y = y + 2 * bh + 3;}
-    xo = xo + ((port % 16) / 8) * 3;
-    x = xo + ((port % 16) / 2) * bw;
+    case DRAW_RECT:
+      tft.drawRect(cmd.x, cmd.y, cmd.w, cmd.h, cmd.color);
+      break;
+    case DRAW_FILL_RECT:
+      tft.fillRect(cmd.x, cmd.y, cmd.w, cmd.h, cmd.color);
+      break;
+    case DRAW_FILL_ROUND_RECT:
+      tft.fillRoundRect(cmd.x, cmd.y, cmd.w, cmd.h, cmd.r, cmd.color);
+      break;
   }
-  if (type == TYPE_FRAME)
-  // draw port frame
+}
+
+void OXRS_LCD::_flush_draws(void)
+{
+  LCD_TRACE_SCOPE("_flush_draws");
+  render_stat_scope stat(_render_stats.flush_draws);
+  write_scope write(*this);
+  if (_draws.areas()) _write_open();
+
+  bool shadowed = _flush_shadow();
+  for (int a = 0; a < _draws.areas() && !shadowed; a++)
   {
-    color = (state != PORT_STATE_NA) ? TFT_WHITE : TFT_DARKGREY;
-    tft.drawRect(x, y, bw, bh, color);
-    tft.fillRect(x+1, y+1, bw-2, bh-2, TFT_BLACK);
+    const draw_area& area = _draws.area(a);
+    if (_push_area(area)) continue;
+
+    // not all of the area is painted by the list, draw its commands once
+    // the pushes before are on the display
+    if (_transport) _transport->wait();
+    for (int i = 0; i < _draws.count(); i++)
+    {
+      const draw_cmd& cmd = _draws[i];
+      if (draw_list::inside(cmd, area)) _draw_cmd(cmd);
+    }
   }
-  else
-  // draw virtual led in port
+  _draws.clear();
+
+  // on the display before the callers draw around the ports (_clear_event, ...)
+  if (_transport) _transport->wait();
+
+  // the queued pin changes are on the display now, unless some are left to
+  // the next loop()
+  for (int mcp = 0; mcp < 8 && !_scheduled(); mcp++)
   {
-    color = color_map[state];
-    switch (index % 4)
+    if (!_latency_pending[mcp]) continue;
+
+    uint32_t latency_us = micros() - _latency_seen_us[mcp];
+    while (_latency_pending[mcp])
     {
-      case 0:
-        tft.fillRoundRect(x+2     , y+2      , bw/2-2, bh/2-2, 2, color);
-        break;
-      case 1:
-        tft.fillRoundRect(x+2     , y+bh/2+1 , bw/2-2, bh/2-2, 2, color);
-        break;
-      case 2:
-        tft.fillRoundRect(x+1+bw/2, y+2      , bw/2-2, bh/2-2, 2, color);
-        break;
-      case 3:
-        tft.fillRoundRect(x+1+bw/2, y+bh/2+1 , bw/2-2, bh/2-2, 2, color);
-        break;
+      _add_latency(latency_us);
+      _latency_pending[mcp]--;
     }
-  }     
+  }
 }
 
-/**
-  // Security sensor logic table (using our internal state constants)
-  //
-  // Sensor     CH4   CH3   CH2   CH1       State           Event
-  // -------------------------------------------------------------------
-  // NORMAL     ON    OFF   ON    OFF   =>  IS_HIGH         HIGH_EVENT          B00000101   GREEN
-  // ALARM      ON    ON    ON    OFF   =>  IS_LOW          LOW_EVENT           B00000001   RED
-  // TAMPER     ON    ON    OFF   ON    =>  DEBOUNCE_LOW    TAMPER_EVENT        B00000010   MAGENTA
-  // SHORT      OFF   OFF   ON    OFF   =>  DEBOUNCE_HIGH   SHORT_EVENT         B00001101   MAGENTA
-  //                                                        FAULT_EVENT         all other   CYAN
-**/
-void OXRS_LCD::_update_security(uint8_t type, uint8_t port, int state)
+// render a damaged area in bands of whole rows and stream them into one
+// address window, false when the list does not paint all of its pixels on
+// the display
+bool OXRS_LCD::_push_area(const draw_area& damaged)
 {
-  // NORMAL, ALARM, TAMPER or SHORT, NC, FAULT
-  uint16_t color_map[4] = {TFT_GREEN, TFT_RED, TFT_MAGENTA, TFT_CYAN};
-  
-  int bw =  _layout_config.bw;
-  int bh =  _layout_config.bh;
-  int xo =  _layout_config.xo;
-  int x =   _layout_config.x;
-  int y =   _layout_config.y;
-  uint16_t color;
-  bool flash;
-
-  // calculate the max (1-based) index for this port and check 
-  if (((port * 4) + 4) > _layout_config.index_max) return;
-  
-  y = y + (port % 2) * bh;
-  if (    _port_layout == PORT_LAYOUT_INPUT_96 
-      ||  _port_layout == PORT_LAYOUT_IO_96_32 
-      ||  _port_layout == PORT_LAYOUT_IO_96_32_8 )
+  draw_area area = damaged;
+  if (!_clip(area)) return true;
+  if (!_draw_buffer) return false;
+
+  // a lone fillRect is a single window already
+  int commands = 0;
+  bool fill_only = true;
+  for (int i = 0; i < _draws.count() && commands < 2; i++)
   {
-    xo = xo + (port / 8) * 3;
-    x = xo + (port / 2) * bw;
+    const draw_cmd& cmd = _draws[i];
+    if (cmd.kind == DRAW_NONE || !draw_list::inside(cmd, damaged)) continue;
+    commands++;
+    fill_only = (cmd.kind == DRAW_FILL_RECT);
   }
-  else
+  if (commands == 1 && fill_only) return false;
+
+  int rows = DRAW_BUFFER_PIXELS / area.w;
+  if (rows == 0) return false;
+
+  // check every band before the window is opened, a single one stays rendered
+  for (int y = area.y; y < area.y + area.h; y += rows)
   {
-    if (port > 15) {y = y + 2 * bh + 3;}
-    xo = xo + ((port % 16) / 8) * 3;
-    x = xo + ((port % 16) / 2) * bw;
+    if (!_render(_band(area, y, rows))) return false;
   }
 
-  if (type == TYPE_FRAME)
-  // draw port frame
+  bool swap = tft.getSwapBytes();
+  tft.setSwapBytes(true);
+  write_scope write(*this);
+  _write_open();
+  _push_window(area.x, area.y, area.w, area.h);
+  for (int y = area.y; y < area.y + area.h; y += rows)
   {
-    color = (state != PORT_STATE_NA) ? TFT_WHITE : TFT_DARKGREY;
-    tft.drawRect(x, y, bw, bh, color);
+    draw_area band = _band(area, y, rows);
+    if (area.h > rows) _render(band);
+    _push_buffer(band.w * band.h);
+  }
+  tft.setSwapBytes(swap);
+  return true;
+}
+
+// the part of area on the display, false when none is left
+bool OXRS_LCD::_clip(draw_area& area)
+{
+  int x1 = (area.x + area.w < tft.width()) ? area.x + area.w : tft.width();
+  int y1 = (area.y + area.h < tft.height()) ? area.y + area.h : tft.height();
+  if (area.x < 0) area.x = 0;
+  if (area.y < 0) area.y = 0;
+  area.w = x1 - area.x;
+  area.h = y1 - area.y;
+  return area.w > 0 && area.h > 0;
+}
+
+// _draws.render() into _draw_buffer. a band of no more than LED_TILE_PIXELS
+// drawn by the same commands (relative to it) as before is an LED cell going
+// back to a state it showed already, its pixels are copied from the tile
+// kept then instead of rasterising the round rects again
+bool OXRS_LCD::_render(const draw_area& band)
+{
+#ifndef OXRS_LCD_NO_LED_TILES
+  int size = band.w * band.h;
+  if (!_led_tiles || size > LED_TILE_PIXELS) return _draws.render(band, _draw_buffer);
+
+  draw_cmd cmds[LED_TILE_CMDS];
+  int count = 0;
+  for (int i = 0; i < _draws.count(); i++)
+  {
+    draw_cmd cmd = _draws[i];
+    if (cmd.kind == DRAW_NONE || cmd.x >= band.x + band.w || cmd.y >= band.y + band.h ||
+        cmd.x + cmd.w <= band.x || cmd.y + cmd.h <= band.y) continue;
+    if (count == LED_TILE_CMDS) return _draws.render(band, _draw_buffer);
+
+    cmd.x -= band.x;
+    cmd.y -= band.y;
+    cmds[count++] = cmd;
+  }
+
+  for (int t = 0; t < LED_TILES; t++)
+  {
+    led_tile& tile = _led_tiles[t];
+    if (tile.w != band.w || tile.h != band.h || tile.count != count ||
+        memcmp(tile.cmds, cmds, count * sizeof(draw_cmd)) != 0) continue;
+
+    memcpy(_draw_buffer, tile.pixels, size * sizeof(uint16_t));
+    return true;
+  }
+
+  // only fully painted bands, the others depend on what is under them
+  if (!_draws.render(band, _draw_buffer)) return false;
+
+  led_tile& tile = _led_tiles[_led_tile_next];
+  _led_tile_next = (_led_tile_next + 1) % LED_TILES;
+  tile.w = band.w;
+  tile.h = band.h;
+  tile.count = count;
+  memcpy(tile.cmds, cmds, count * sizeof(draw_cmd));
+  memcpy(tile.pixels, _draw_buffer, size * sizeof(uint16_t));
+  return true;
+#else
+  return _draws.render(band, _draw_buffer);
+#endif
+}
+
+/*
+ * LED tiles :
+ * the last LED_TILES cells rendered (6.6 KB) are kept by _render() and
+ * copied when an LED goes back to a state it showed, off by default. returns
+ * false when they cannot be allocated, with the render queue on and when
+ * compiled out (OXRS_LCD_NO_LED_TILES)
+ */
+bool OXRS_LCD::setLedTiles(bool tiles)
+{
+#ifndef OXRS_LCD_NO_LED_TILES
+  if (_queue_on) return false;
+
+  free(_led_tiles);
+  _led_tiles = NULL;
+  _led_tile_next = 0;
+  if (!tiles) return true;
+
+  _led_tiles = (led_tile *)calloc(LED_TILES, sizeof(led_tile));
+  return _led_tiles != NULL;
+#else
+  return !tiles;
+#endif
+}
+
+bool OXRS_LCD::getLedTiles(void)
+{
+#ifndef OXRS_LCD_NO_LED_TILES
+  return _led_tiles != NULL;
+#else
+  return false;
+#endif
+}
+
+// rows y .. y+rows-1 of area, fewer at its bottom
+draw_area OXRS_LCD::_band(const draw_area& area, int y, int rows)
+{
+  if (y + rows > area.y + area.h) rows = area.y + area.h - y;
+
+  draw_area band = {area.x, (int16_t)y, area.w, (int16_t)rows};
+  return band;
+}
+
+/*
+ * render budget :
+ * with a budget, process() leaves the LED changes pending and loop() paints
+ * them by class within budget_us: security ports in alarm or tamper, the
+ * other inputs, the outputs, then the rx/tx LEDs and the event bar,
+ * SCHEDULE_CHUNK LEDs per flush. the timers and the IP and MQTT state are
+ * checked before them in every call, the flashing runs once nothing is
+ * pending and time is left. what is left over goes first in the next
+ * call. alarms are painted in full every call and at least one chunk after
+ * them, so a storm cannot starve the others. 0 (default) paints all in each
+ * call, what a budget left pending is painted when it is set to 0
+ */
+void OXRS_LCD::setRenderBudget(uint32_t budget_us)
+{
+  _setting(SETTING_RENDER_BUDGET, budget_us);
+}
+
+// the states the pending LEDs are to show are allocated with a budget, they
+// are painted before the budget goes. no budget when they cannot be
+void OXRS_LCD::_set_budget(uint32_t budget_us)
+{
+  if (budget_us && !_wants) _wants = (budget_wants *)malloc(sizeof(budget_wants));
+  if (budget_us && _wants)
+  {
+    _budget_us = budget_us;
+    return;
+  }
+
+  _budget_us = 0;
+  if (_scheduled()) _schedule(micros());
+  free(_wants);
+  _wants = NULL;
+}
+
+// LEDs waiting for loop()
+int OXRS_LCD::getPendingRepaints(void)
+{
+  if (_queue_on) return _shown_pending.load(std::memory_order_relaxed);
+  return _pending_repaints();
+}
+
+int OXRS_LCD::_pending_repaints(void)
+{
+  int pending = __builtin_popcount(_pending_security) + __builtin_popcount(_pending_status);
+  for (int w = 0; w < 4; w++)
+  {
+    pending += __builtin_popcount(_pending_in[w]) + __builtin_popcount(_pending_out[w]);
+  }
+  return pending;
+}
+
+void OXRS_LCD::_schedule_clear(void)
+{
+  _pending_security = 0;
+  memset(_pending_in, 0, sizeof(_pending_in));
+  memset(_pending_out, 0, sizeof(_pending_out));
+  _pending_status = 0;
+}
+
+bool OXRS_LCD::_scheduled(void)
+{
+  return _pending_security | _pending_in[0] | _pending_in[1] | _pending_in[2] | _pending_in[3] |
+         _pending_out[0] | _pending_out[1] | _pending_out[2] | _pending_out[3] | _pending_status;
+}
+
+bool OXRS_LCD::_over_budget(uint32_t start_us)
+{
+  return _budget_us && (uint32_t)(micros() - start_us) >= _budget_us;
+}
+
+// an LED of a pin change, painted now without a budget
+void OXRS_LCD::_schedule_security(uint8_t port, int state)
+{
+  if (!_budget_us) return _update_security(TYPE_STATE, port, state);
+
+  _wants->security[port] = state;
+  bitSet(_pending_security, port);
+}
+
+void OXRS_LCD::_schedule_input(uint8_t index, int state)
+{
+  if (!_budget_us) return _update_input(TYPE_STATE, index, state);
+
+  _wants->in[index - 1] = state;
+  bitSet(_pending_in[(index - 1) / 32], (index - 1) % 32);
+}
+
+void OXRS_LCD::_schedule_output(uint8_t index, int state)
+{
+  if (!_budget_us) return _update_output(TYPE_STATE, index, state);
+
+  _wants->out[index - 1] = state;
+  bitSet(_pending_out[(index - 1) / 32], (index - 1) % 32);
+}
+
+#ifndef OXRS_LCD_NO_IO_48
+// the inputs of IO_48 go with the inputs, its outputs with the outputs
+void OXRS_LCD::_schedule_io_48(uint8_t index, int state)
+{
+  if (!_budget_us) return _update_io_48(TYPE_STATE, index, state);
+
+  if (index <= 16) _schedule_input(index, state);
+  else _schedule_output(index, state);
+}
+#endif
+
+// the MQTT rx/tx LEDs and the event bar, the same way. the event clear timer
+// runs from when it was shown
+void OXRS_LCD::_schedule_rx_led(int state)
+{
+  if (!_budget_us) return _set_mqtt_rx_led(state);
+
+  _wants->rx_led = state;
+  bitSet(_pending_status, PENDING_RX_LED);
+}
+
+void OXRS_LCD::_schedule_tx_led(int state)
+{
+  if (!_budget_us) return _set_mqtt_tx_led(state);
+
+  _wants->tx_led = state;
+  bitSet(_pending_status, PENDING_TX_LED);
+}
+
+void OXRS_LCD::_schedule_event(const char * s_event, int font)
+{
+  bitClear(_pending_status, PENDING_EVENT_CLEAR);
+  bitClear(_pending_status, PENDING_EVENT);
+  if (!_budget_us) return _show_event(s_event, font);
+
+  strncpy(_wants->event.text, s_event, sizeof(_wants->event.text) - 1);
+  _wants->event.text[sizeof(_wants->event.text) - 1] = 0;
+  _wants->event_font = font;
+  _last_event_display = millis();
+  bitSet(_pending_status, PENDING_EVENT);
+}
+
+void OXRS_LCD::_schedule_event_clear(void)
+{
+  bitClear(_pending_status, PENDING_EVENT);
+  bitClear(_pending_status, PENDING_EVENT_CLEAR);
+  if (!_budget_us) return _clear_event();
+
+  bitSet(_pending_status, PENDING_EVENT_CLEAR);
+}
+
+// false when the budget ran out with LEDs left
+bool OXRS_LCD::_schedule(uint32_t start_us)
+{
+  LCD_TRACE_SCOPE("_schedule");
+  write_scope write(*this);
+
+  // alarm and tamper, whatever the budget
+  for (int port = 0; port < 32; port++)
+  {
+    if (!bitRead(_pending_security, port)) continue;
+
+    bool flash;
+    uint8_t shade = _security_shade(port, _wants->security[port], flash);
+    if (shade != 1 && shade != 2) continue;
+
+    bitClear(_pending_security, port);
+    _update_security(TYPE_STATE, port, _wants->security[port]);
+  }
+  _flush_draws();
+
+  // the status paints last, in a chunk the LEDs of pins left room in
+  bool chunked = false;
+  while (_scheduled())
+  {
+    if (chunked && _over_budget(start_us)) return false;
+    chunked = true;
+
+    int painted = _schedule_inputs(SCHEDULE_CHUNK);
+    painted += _schedule_outputs(SCHEDULE_CHUNK - painted);
+    if (painted < SCHEDULE_CHUNK) _schedule_status();
+    _flush_draws();
+  }
+  return !_over_budget(start_us);
+}
+
+// up to count pending security ports and input LEDs painted, returns how many
+int OXRS_LCD::_schedule_inputs(int count)
+{
+  int painted = 0;
+  while (_pending_security && painted < count)
+  {
+    int port = __builtin_ctz(_pending_security);
+    _pending_security &= _pending_security - 1;
+    _update_security(TYPE_STATE, port, _wants->security[port]);
+    painted++;
+  }
+
+  for (int w = 0; w < 4 && painted < count; w++)
+  {
+    while (_pending_in[w] && painted < count)
+    {
+      int i = w * 32 + __builtin_ctz(_pending_in[w]);
+      _pending_in[w] &= _pending_in[w] - 1;
+      (this->*_paint_in_fn)(TYPE_STATE, i + 1, _wants->in[i]);
+      painted++;
+    }
+  }
+  return painted;
+}
+
+// the same for the output LEDs, one window each: one over neighbours has to
+// push the frame column between them, dearer than a window below 80 MHz SPI
+int OXRS_LCD::_schedule_outputs(int count)
+{
+  int painted = 0;
+  for (int w = 0; w < 4 && painted < count; w++)
+  {
+    while (_pending_out[w] && painted < count)
+    {
+      int i = w * 32 + __builtin_ctz(_pending_out[w]);
+      _pending_out[w] &= _pending_out[w] - 1;
+      (this->*_paint_out_fn)(TYPE_STATE, i + 1, _wants->out[i]);
+      painted++;
+    }
+  }
+  return painted;
+}
+
+// the pending status paints, drawn straight away, returns how many
+int OXRS_LCD::_schedule_status(void)
+{
+  int painted = __builtin_popcount(_pending_status);
+  if (bitRead(_pending_status, PENDING_RX_LED)) _set_mqtt_rx_led(_wants->rx_led);
+  if (bitRead(_pending_status, PENDING_TX_LED)) _set_mqtt_tx_led(_wants->tx_led);
+  if (bitRead(_pending_status, PENDING_EVENT)) _show_event(_wants->event.text, _wants->event_font);
+  if (bitRead(_pending_status, PENDING_EVENT_CLEAR)) _clear_event();
+  _pending_status = 0;
+  return painted;
+}
+
+/*
+ * render queue :
+ * with the queue on, process(), loop(), triggerMqttRxLed/TxLed(), showEvent(),
+ * showTemp(), setPin...() and showDiagnostics() post records (see
+ * OXRS_LCD_queue->records.h) and drainRenderQueue() draws them, on a task or thread
+ * of its own. loop() keeps polling Ethernet, WiFi and MQTT and posts their
+ * states with the IP, MAC and topic, the render side never touches them.
+ * the setters of the timers, brightness, info rows and budget and
+ * startRecording()/stopRecording() are posted as well. getRenderStats() and
+ * resetRenderStats() wait for the render side, screenDrawn(),
+ * getHeaderResult(), diagnosticsShown(), getShadowBuffer() and
+ * getPendingRepaints() return what it had at the end of its last pass.
+ * setShadowBuffer(), setLedTiles() and setTransport() fail with the queue on.
+ * begin(), drawHeader() and drawPorts() draw straight away, call them (and
+ * startDrawHeader/Ports) before the queue is turned on. the rings are
+ * allocated when it is turned on (false when they cannot be) and freed when
+ * it is turned off, only once nothing drains it
+ */
+bool OXRS_LCD::setRenderQueue(bool queue)
+{
+#if defined(ESP32)
+  // the render task keeps the queue until stopRenderTask()
+  if (_render_task) return queue;
+#endif
+
+  _posted_mcps = 0;
+  _overflow_mcps = 0;
+  _posted_link = 0xffff;
+  _posted_no_ip = false;
+  _queued_ip_state = _ip_state;
+  _queued_mqtt_state = _mqtt_state;
+  _render_stalled = false;
+  _render_shown();
+  if (!queue)
+  {
+    _queue_on = false;
+    delete _queue;
+    _queue = NULL;
+    return true;
+  }
+
+  // turned on again, what is in flight stays
+  if (!_queue)
+  {
+    _queue = new (std::nothrow) render_queue();
+    if (!_queue) return false;
+    _stats_requested = _stats_done.load(std::memory_order_relaxed);
+  }
+  _queue_on = true;
+  return true;
+}
+
+// render side: the records posted so far in their order, then what loop() does
+void OXRS_LCD::drainRenderQueue(void)
+{
+  lcd_record record;
+
+  _draining = true;
+  while (_queue->records.pop(record))
+  {
+    _apply(record);
+    _drains.fetch_add(1, std::memory_order_release);
+  }
+  _draining = false;
+
+  _loop();
+  _render_shown();
+  _drains.fetch_add(1, std::memory_order_release);
+}
+
+// render side: the state the getters read with the queue on
+void OXRS_LCD::_render_shown(void)
+{
+  _shown_screen_drawn.store(_screen_drawn(), std::memory_order_relaxed);
+  _shown_diagnostics.store(_diag_shown, std::memory_order_relaxed);
+  _shown_header_result.store(_header_result, std::memory_order_relaxed);
+  _shown_shadow_mode.store(_shadow_mode, std::memory_order_relaxed);
+  _shown_pending.store(_pending_repaints(), std::memory_order_relaxed);
+}
+
+#if defined(ESP32)
+/*
+ * the render side as a task pinned to core, the firmware loop keeps its core
+ * for the I2C polling. the SPI driver locks the bus per transaction, so the
+ * W5500 of the RACK32 can be served from the other core meanwhile
+ */
+bool OXRS_LCD::startRenderTask(int core, int priority)
+{
+  if (_render_task) return true;
+
+  if (!setRenderQueue(true)) return false;
+  _render_stop = false;
+  _render_stopped = false;
+  if (xTaskCreatePinnedToCore(_render_task_main, "OXRS_LCD", RENDER_TASK_STACK, this, priority, &_render_task, core) == pdPASS) return true;
+
+  _render_task = NULL;
+  setRenderQueue(false);
+  return false;
+}
+
+/*
+ * the render task drains what was posted before the call and ends between two
+ * passes, never inside an SPI transaction. the queue is turned off and the
+ * io_values that found it full are drawn on this core
+ */
+void OXRS_LCD::stopRenderTask(void)
+{
+  if (!_render_task) return;
+
+  _render_stop.store(true, std::memory_order_release);
+  xTaskNotifyGive(_render_task);
+  while (!_render_stopped.load(std::memory_order_acquire))
+  {
+    vTaskDelay(1);
+  }
+  _render_task = NULL;
+
+  while (_overflow_mcps)
+  {
+    _post_overflow();
+    drainRenderQueue();
+  }
+  setRenderQueue(false);
+}
+
+void OXRS_LCD::_render_task_main(void * lcd)
+{
+  OXRS_LCD * screen = (OXRS_LCD *)lcd;
+  while (!screen->_render_stop.load(std::memory_order_acquire))
+  {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RENDER_TASK_IDLE_MS));
+    screen->drainRenderQueue();
+  }
+  screen->drainRenderQueue();
+
+  // the screen is not touched once stopped is seen, it may be gone
+  screen->_render_stopped.store(true, std::memory_order_release);
+  vTaskDelete(NULL);
+}
+#endif
+
+void OXRS_LCD::_render_wake(void)
+{
+#if defined(ESP32)
+  if (_render_task) xTaskNotifyGive(_render_task);
+#endif
+}
+
+// firmware side: an io_value that differs from the last one posted for mcp
+bool OXRS_LCD::_queue_process(uint8_t mcp, uint16_t io_value)
+{
+  if (!_queue_on) return false;
+  if (mcp > 7) return true;
+  if (bitRead(_posted_mcps, mcp) && _posted_io[mcp] == io_value) return true;
+
+  _posted_io[mcp] = io_value;
+  bitSet(_posted_mcps, mcp);
+
+  // with the queue full the newest io_value of mcp waits for the next post,
+  // the ones between are lost as with a slower poll
+  _post_overflow();
+  lcd_record record = {RECORD_PROCESS, mcp, io_value, (uint32_t)micros()};
+  if (bitRead(_overflow_mcps, mcp) || !_queue->records.push(record))
+  {
+    if (!bitRead(_overflow_mcps, mcp)) _overflow_us[mcp] = record.us;
+    bitSet(_overflow_mcps, mcp);
+    return true;
+  }
+  _render_wake();
+  return true;
+}
+
+void OXRS_LCD::_post_overflow(void)
+{
+  for (uint8_t mcp = 0; _overflow_mcps && mcp < 8; mcp++)
+  {
+    if (!bitRead(_overflow_mcps, mcp)) continue;
+
+    lcd_record record = {RECORD_PROCESS, mcp, _posted_io[mcp], _overflow_us[mcp]};
+    if (!_queue->records.push(record)) return;
+    bitClear(_overflow_mcps, mcp);
+    _render_wake();
+  }
+}
+
+// firmware side: rx/tx LEDs are dropped when the queue is full, the rest
+// waits for the render side to make room, and is dropped once it stalls
+bool OXRS_LCD::_post(uint8_t kind, uint8_t mcp, uint16_t value, uint32_t us)
+{
+  _post_overflow();
+
+  lcd_record record = {kind, mcp, value, us};
+  uint32_t spins = 0;
+  while (!_queue->records.push(record))
+  {
+    if (kind == RECORD_MQTT_RX || kind == RECORD_MQTT_TX || !_render_waiting(spins))
+    {
+      _queue_dropped++;
+      return false;
+    }
+  }
+  _render_wake();
+  return true;
+}
+
+// firmware side: one turn of a wait for the render side, false once it has
+// not drained for RENDER_QUEUE_WAIT_SPINS turns (not running, stopped or
+// stuck), and at once from then on until it drains again
+bool OXRS_LCD::_render_waiting(uint32_t& spins)
+{
+  uint32_t drains = _drains.load(std::memory_order_acquire);
+  if (drains != _waited_drains)
+  {
+    _waited_drains = drains;
+    _render_stalled = false;
+    spins = 0;
+  }
+  if (_render_stalled || ++spins > RENDER_QUEUE_WAIT_SPINS)
+  {
+    _render_stalled = true;
+    return false;
+  }
+  _render_wake();
+  yield();
+  return true;
+}
+
+// firmware side: the link states when they change, with what the render side
+// shows of them. while DHCP has not issued an IP yet it is read again, as
+// _check_IP_state() does without the queue
+void OXRS_LCD::_post_link(void)
+{
+  uint16_t link = _get_IP_state() | (_get_MQTT_state() << 8);
+  if (link == _posted_link && !_posted_no_ip) return;
+
+  IPAddress ip = _get_IP_address();
+  bool no_ip = (link & 0xff) == IP_STATE_UP && ip[0] == 0;
+  if (link == _posted_link && no_ip) return;
+
+  lcd_link info;
+  for (int i = 0; i < 4; i++) info.ip[i] = ip[i];
+  _get_MAC_address(info.mac);
+  info.topic[0] = 0;
+  if ((link >> 8) != MQTT_STATE_UNKNOWN)
+  {
+    char topic[64];
+    strncat(info.topic, _mqtt->getWildcardTopic(topic), sizeof(info.topic) - 1);
+  }
+
+  // room for the record first, the link ring is read by it. with the render
+  // side stalled it is posted by a later loop()
+  uint32_t spins = 0;
+  _post_overflow();
+  while (_overflow_mcps || !_queue->records.space() || !_queue->links.space())
+  {
+    if (!_render_waiting(spins)) return;
+    _post_overflow();
+  }
+  _queue->links.push(info);
+  _posted_link = link;
+  _posted_no_ip = no_ip;
+  _post(RECORD_LINK, 0, link);
+}
+
+// firmware side: the render side copies or resets the stats between two
+// records, this waits until it has. one request at a time, the copy it
+// writes is the one not returned. false when the render side stalled
+bool OXRS_LCD::_request_stats(uint16_t value)
+{
+  if (_stats_done.load(std::memory_order_acquire) == _stats_requested)
+  {
+    if (!_post(RECORD_STATS, 0, value)) return false;
+    _stats_requested++;
+  }
+
+  uint32_t spins = 0;
+  while (_stats_done.load(std::memory_order_acquire) != _stats_requested)
+  {
+    if (!_render_waiting(spins)) return false;
+  }
+  return true;
+}
+
+void OXRS_LCD::_apply(const lcd_record& record)
+{
+  switch (record.kind)
+  {
+    case RECORD_PROCESS:
+      _draining_us = record.us;
+      _process(record.mcp, record.value);
+      break;
+    case RECORD_MQTT_RX:
+      _trigger_mqtt_rx_led();
+      break;
+    case RECORD_MQTT_TX:
+      _trigger_mqtt_tx_led();
+      break;
+    case RECORD_EVENT:
+    {
+      lcd_event_text event;
+      if (_queue->events.pop(event)) _schedule_event(event.text, record.value);
+      break;
+    }
+    case RECORD_TEMP:
+      _show_temp((record.value == RECORD_TEMP_NAN) ? NAN : (int16_t)record.value / 10.0f, record.mcp);
+      break;
+    case RECORD_PIN_TYPE:
+      _set_pin_type(record.mcp, record.value & 0xff, record.value >> 8);
+      break;
+    case RECORD_PIN_INVERT:
+      _set_pin_invert(record.mcp, record.value & 0xff, record.value >> 8);
+      break;
+    case RECORD_PIN_DISABLED:
+      _set_pin_disabled(record.mcp, record.value & 0xff, record.value >> 8);
+      break;
+    case RECORD_DIAGNOSTICS:
+      _show_diagnostics(record.value);
+      break;
+    case RECORD_LINK:
+      _queued_ip_state = record.value & 0xff;
+      _queued_mqtt_state = record.value >> 8;
+      _queue->links.pop(_queue->link);
+
+      // in order with the rx/tx LEDs posted after it, not at the end of the drain
+      if (_screen_drawn() && !_diag_shown)
+      {
+        _check_IP_state(_queued_ip_state);
+        _check_MQTT_state(_queued_mqtt_state);
+      }
+      break;
+    case RECORD_STATS:
+    {
+      if (record.value == RECORD_STATS_RESET)
+      {
+        memset(&_render_stats, 0, sizeof(_render_stats));
+        _render_stats.since_ms = millis();
+      }
+      uint32_t done = _stats_done.load(std::memory_order_relaxed) + 1;
+      _queue->stats[done & 1] = _render_stats;
+      _stats_done.store(done, std::memory_order_release);
+      break;
+    }
+    case RECORD_SETTING:
+      _set_setting(record.mcp, (int32_t)record.us);
+      break;
+    case RECORD_RECORDING:
+    {
+      Print * out;
+      if (_queue->recorders.pop(out)) _start_recording(out);
+      break;
+    }
+  }
+}
+
+/*
+ * transport :
+ * the pixel pushes of _push_area(), _push_shadow() and the logo go to a
+ * transport that may send them in the background (see OXRS_LCD_transport.h),
+ * with a second draw buffer to render into meanwhile. NULL goes back to the
+ * pushes of TFT_eSPI. returns false when the second buffer cannot be allocated
+ * and with the render queue on
+ */
+bool OXRS_LCD::setTransport(lcd_transport * transport)
+{
+  if (_queue_on) return false;
+  _flush_draws();
+
+  free(_draw_buffer_next == _draw_pixels ? _draw_buffer : _draw_buffer_next);
+  _draw_buffer = _draw_pixels;
+  _draw_buffer_next = NULL;
+  _transport = NULL;
+  if (!transport) return true;
+
+  _draw_buffer_next = draw_buffer_alloc();
+  if (!_draw_buffer_next) return false;
+
+  _transport = transport;
+  return true;
+}
+
+void OXRS_LCD::_push_window(int x, int y, int w, int h)
+{
+  if (_transport) _transport->window(x, y, w, h);
+  else tft.setAddrWindow(x, y, w, h);
+}
+
+void OXRS_LCD::_push_pixels(uint16_t * pixels, uint32_t len)
+{
+  if (_transport) _transport->push(pixels, len);
+  else tft.pushPixels(pixels, len);
+}
+
+// push _draw_buffer, the next block goes into the other one
+void OXRS_LCD::_push_buffer(uint32_t len)
+{
+  _push_pixels(_draw_buffer, len);
+  if (!_draw_buffer_next) return;
+
+  uint16_t * sent = _draw_buffer;
+  _draw_buffer = _draw_buffer_next;
+  _draw_buffer_next = sent;
+}
+
+// a logo row of w pixels, as pushImage(x, y, w, 1) would draw it. rows on the
+// display go to the transport, false when there is none or the row is cut
+bool OXRS_LCD::_push_bmp_row(uint16_t * pixels, int16_t x, int16_t y, int16_t w)
+{
+  if (!_transport) return false;
+  if (x < 0 || y < 0 || x + w > tft.width() || y >= tft.height())
+  {
+    _transport->wait();
+    return false;
+  }
+
+  _push_window(x, y, w, 1);
+  _push_pixels(pixels, w);
+  return true;
+}
+
+/*
+ * shadow buffer :
+ * a copy of the port area (rows SHADOW_Y ..) in RAM, the queued port draws are
+ * rendered into it and only the 16x16 tiles whose hash changed are pushed, so
+ * a port painted the way it already is (flash, forced refresh) costs no bus time.
+ *
+ * SHADOW_RGB565   16 bit pixels, 53 KB, allocated from PSRAM on BOARD_HAS_PSRAM
+ * SHADOW_PALETTE  4 bit palette index, 13 KB, turns itself off at a 17th colour
+ *
+ * set it after begin() and before drawPorts(), it clears the port area.
+ * returns false when the buffer cannot be allocated, the library then draws
+ * without as before, before begin() and with the render queue on
+ */
+bool OXRS_LCD::setShadowBuffer(int mode)
+{
+  if (_queue_on || (mode != SHADOW_OFF && !_draw_pixels)) return false;
+  _flush_draws();
+
+  _shadow_off();
+  if (mode == SHADOW_OFF) return true;
+
+  size_t size = (mode == SHADOW_RGB565) ? 240 * SHADOW_H * 2 : 240 * SHADOW_H / 2;
+#ifdef BOARD_HAS_PSRAM
+  _shadow = (uint8_t *)((mode == SHADOW_RGB565) ? ps_malloc(size) : malloc(size));
+#else
+  _shadow = (uint8_t *)malloc(size);
+#endif
+  _tile_hash = (uint32_t *)malloc(SHADOW_TILES * sizeof(uint32_t));
+  if (!_shadow || !_tile_hash)
+  {
+    _shadow_off();
+    return false;
+  }
+
+  // black, as the display is made to be
+  memset(_shadow, 0, size);
+  _palette[0] = TFT_BLACK;
+  _palette_size = 1;
+  _shadow_mode = mode;
+  for (int tile = 0; tile < SHADOW_TILES; tile++)
+  {
+    _tile_hash[tile] = _shadow_hash(tile);
+  }
+  tft.fillRect(0, SHADOW_Y, 240, SHADOW_H, TFT_BLACK);
+  _drawn_clear();
+  return true;
+}
+
+int OXRS_LCD::getShadowBuffer(void)
+{
+  if (_queue_on) return _shown_shadow_mode.load(std::memory_order_relaxed);
+  return _shadow_mode;
+}
+
+void OXRS_LCD::_shadow_off(void)
+{
+  free(_shadow);
+  free(_tile_hash);
+  _shadow = NULL;
+  _tile_hash = NULL;
+  _shadow_mode = SHADOW_OFF;
+}
+
+uint16_t OXRS_LCD::_shadow_get(int x, int y)
+{
+  int i = (y - SHADOW_Y) * 240 + x;
+  if (_shadow_mode == SHADOW_RGB565) return ((uint16_t *)_shadow)[i];
+
+  return _palette[(_shadow[i / 2] >> ((i & 1) * 4)) & 0x0f];
+}
+
+// false when the palette is full
+bool OXRS_LCD::_shadow_set(int x, int y, uint16_t color)
+{
+  int i = (y - SHADOW_Y) * 240 + x;
+  if (_shadow_mode == SHADOW_RGB565)
+  {
+    ((uint16_t *)_shadow)[i] = color;
+    return true;
+  }
+
+  int index = 0;
+  while (index < _palette_size && _palette[index] != color) index++;
+  if (index == _palette_size)
+  {
+    if (_palette_size == 16) return false;
+    _palette[_palette_size++] = color;
+  }
+  _shadow[i / 2] = (_shadow[i / 2] & ((i & 1) ? 0x0f : 0xf0)) | (index << ((i & 1) * 4));
+  return true;
+}
+
+// FNV-1a over the colours of a tile
+uint32_t OXRS_LCD::_shadow_hash(int tile)
+{
+  int x0 = (tile % SHADOW_TILES_X) * SHADOW_TILE;
+  int y0 = SHADOW_Y + (tile / SHADOW_TILES_X) * SHADOW_TILE;
+
+  uint32_t hash = 2166136261UL;
+  for (int y = y0; y < y0 + SHADOW_TILE; y++)
+  {
+    for (int x = x0; x < x0 + SHADOW_TILE; x++)
+    {
+      uint16_t color = _shadow_get(x, y);
+      hash = (hash ^ (color & 0xff)) * 16777619UL;
+      hash = (hash ^ (color >> 8)) * 16777619UL;
+    }
+  }
+  return hash;
+}
+
+// render the queued draws into the shadow and push the tiles that changed,
+// false when there is no shadow (any more) and the draws still have to be done
+bool OXRS_LCD::_flush_shadow(void)
+{
+  if (_shadow_mode == SHADOW_OFF) return false;
+
+  // the rows are held, columns off the display are clipped as TFT_eSPI does
+  for (int i = 0; i < _draws.count(); i++)
+  {
+    const draw_cmd& cmd = _draws[i];
+    if (cmd.kind != DRAW_NONE && (cmd.y < SHADOW_Y || cmd.y + cmd.h > SHADOW_Y + SHADOW_H))
+    {
+      _shadow_off();
+      return false;
+    }
+  }
+
+  // the damaged areas in bands of whole rows, drawn over what is there
+  uint8_t dirty[(SHADOW_TILES + 7) / 8];
+  memset(dirty, 0, sizeof(dirty));
+  for (int a = 0; a < _draws.areas(); a++)
+  {
+    draw_area area = _draws.area(a);
+    if (!_clip(area)) continue;
+
+    int rows = DRAW_BUFFER_PIXELS / area.w;
+    for (int y = area.y; y < area.y + area.h; y += rows)
+    {
+      draw_area band = _band(area, y, rows);
+      int i = 0;
+      for (int by = band.y; by < band.y + band.h; by++)
+      {
+        for (int bx = band.x; bx < band.x + band.w; bx++) _draw_buffer[i++] = _shadow_get(bx, by);
+      }
+
+      _render(band);
+
+      i = 0;
+      for (int by = band.y; by < band.y + band.h; by++)
+      {
+        for (int bx = band.x; bx < band.x + band.w; bx++)
+        {
+          if (_shadow_set(bx, by, _draw_buffer[i++])) continue;
+
+          // more colours than the palette holds, the draws go out without
+          _shadow_off();
+          return false;
+        }
+      }
+    }
+
+    for (int ty = (area.y - SHADOW_Y) / SHADOW_TILE; ty <= (area.y + area.h - 1 - SHADOW_Y) / SHADOW_TILE; ty++)
+    {
+      for (int tx = area.x / SHADOW_TILE; tx <= (area.x + area.w - 1) / SHADOW_TILE; tx++)
+      {
+        bitSet(dirty[(ty * SHADOW_TILES_X + tx) / 8], (ty * SHADOW_TILES_X + tx) % 8);
+      }
+    }
+  }
+
+  // keep the tiles that changed
+  for (int tile = 0; tile < SHADOW_TILES; tile++)
+  {
+    if (!bitRead(dirty[tile / 8], tile % 8)) continue;
+
+    uint32_t hash = _shadow_hash(tile);
+    if (hash == _tile_hash[tile])
+    {
+      bitClear(dirty[tile / 8], tile % 8);
+      continue;
+    }
+    _tile_hash[tile] = hash;
+  }
+
+  // the part of every area the changed tiles cover
+  draw_area pushes[DRAW_LIST_SIZE];
+  int count = 0;
+  for (int a = 0; a < _draws.areas(); a++)
+  {
+    draw_area area = _draws.area(a);
+    if (!_clip(area)) continue;
+
+    int x0 = area.x + area.w, y0 = area.y + area.h, x1 = area.x, y1 = area.y;
+    for (int ty = (area.y - SHADOW_Y) / SHADOW_TILE; ty <= (area.y + area.h - 1 - SHADOW_Y) / SHADOW_TILE; ty++)
+    {
+      for (int tx = area.x / SHADOW_TILE; tx <= (area.x + area.w - 1) / SHADOW_TILE; tx++)
+      {
+        if (!bitRead(dirty[(ty * SHADOW_TILES_X + tx) / 8], (ty * SHADOW_TILES_X + tx) % 8)) continue;
+
+        if (tx * SHADOW_TILE < x0) x0 = tx * SHADOW_TILE;
+        if (SHADOW_Y + ty * SHADOW_TILE < y0) y0 = SHADOW_Y + ty * SHADOW_TILE;
+        if ((tx + 1) * SHADOW_TILE > x1) x1 = (tx + 1) * SHADOW_TILE;
+        if (SHADOW_Y + (ty + 1) * SHADOW_TILE > y1) y1 = SHADOW_Y + (ty + 1) * SHADOW_TILE;
+      }
+    }
+    if (x0 >= x1) continue;
+
+    if (x0 > area.x) area.x = x0;
+    if (y0 > area.y) area.y = y0;
+    area.w = ((x1 < area.x + area.w) ? x1 : area.x + area.w) - area.x;
+    area.h = ((y1 < area.y + area.h) ? y1 : area.y + area.h) - area.y;
+    pushes[count++] = area;
+  }
+
+  // one window for two when the pixels in between cost less than opening it
+  for (int i = 0; i < count; i++)
+  {
+    for (int j = i + 1; j < count; j++)
+    {
+      const draw_area& p = pushes[i];
+      const draw_area& q = pushes[j];
+      int x0 = (p.x < q.x) ? p.x : q.x;
+      int y0 = (p.y < q.y) ? p.y : q.y;
+      int x1 = (p.x + p.w > q.x + q.w) ? p.x + p.w : q.x + q.w;
+      int y1 = (p.y + p.h > q.y + q.h) ? p.y + p.h : q.y + q.h;
+      if ((x1 - x0) * (y1 - y0) - p.w * p.h - q.w * q.h > SHADOW_WINDOW_PIXELS) continue;
+
+      draw_area merged = {(int16_t)x0, (int16_t)y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+      pushes[i] = merged;
+      pushes[j] = pushes[--count];
+      j = i;
+    }
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    _push_shadow(pushes[i]);
+  }
+  return true;
+}
+
+// stream a rect of the shadow into one address window
+void OXRS_LCD::_push_shadow(const draw_area& area)
+{
+  int rows = DRAW_BUFFER_PIXELS / area.w;
+
+  bool swap = tft.getSwapBytes();
+  tft.setSwapBytes(true);
+  write_scope write(*this);
+  _write_open();
+  _push_window(area.x, area.y, area.w, area.h);
+  for (int y = area.y; y < area.y + area.h; y += rows)
+  {
+    draw_area band = _band(area, y, rows);
+    int i = 0;
+    for (int by = band.y; by < band.y + band.h; by++)
+    {
+      for (int bx = band.x; bx < band.x + band.w; bx++) _draw_buffer[i++] = _shadow_get(bx, by);
+    }
+    _push_buffer(i);
+  }
+  tft.setSwapBytes(swap);
+}
+
+// cells of the input (and security) ports of _layout_config_in
+void OXRS_LCD::_build_input_cells(bool wide)
+{
+  for (int port = 0; port < CELLS_IN; port++)
+  {
+    _cells_in[port].x = inputCellX(_layout_config_in.xo, _layout_config_in.bw, port, wide);
+    _cells_in[port].y = inputCellY(_layout_config_in.y, _layout_config_in.bh, port, wide);
+  }
+}
+
+// cells of the output pins of _layout_config_out
+void OXRS_LCD::_build_output_cells(void)
+{
+  for (int index = 0; index < CELLS_OUT; index++)
+  {
+    _cells_out[index].x = outputCellX(_layout_config_out.xo, _layout_config_out.bw, index, _mcp_output_pins);
+    _cells_out[index].y = outputCellY(_layout_config_out.y, _layout_config_out.bh, index);
+  }
+}
+
+// nothing known about the LEDs, after the port area was cleared or drawn anew
+void OXRS_LCD::_drawn_clear(void)
+{
+  memset(_drawn_in, LED_DRAWN_NONE, sizeof(_drawn_in));
+  memset(_drawn_security, LED_DRAWN_NONE, sizeof(_drawn_security));
+  memset(_drawn_out, LED_DRAWN_NONE, sizeof(_drawn_out));
+}
+
+// nothing known about the LEDs of an input port, its frame or a security
+// LED was painted over them
+void OXRS_LCD::_drawn_clear_port(int port)
+{
+  memset(&_drawn_in[port * 4], LED_DRAWN_NONE, 4);
+  _drawn_security[port] = LED_DRAWN_NONE;
+}
 
-    tft.fillRect(x+1, y+1, bw-2, bh-2, TFT_BLACK);
-    tft.fillRoundRect(x+2, y+2, bw-4, bh-4, 3, TFT_DARKGREY);
+void OXRS_LCD::_update_input(uint8_t type, uint8_t index, int state)
+{
+  render_stat_scope stat(_render_stats.update_input);
+
+  // OFF, ON, NA, DISABLED
+  uint16_t color_map[4] = {TFT_DARKGREY, TFT_YELLOW, tft.color565(60,60,60), TFT_BLACK};
+  
+  int bw =  _layout_config_in.bw;
+  int bh =  _layout_config_in.bh;
+  uint16_t color;
+
+  if (index > _layout_config_in.index_max) return;
+  
+  index -= 1;
+  int x = _cells_in[index / 4].x;
+  int y = _cells_in[index / 4].y;
+
+  if (type == TYPE_FRAME)
+  // draw port frame
+  {
+    color = (state != PORT_STATE_NA) ? TFT_WHITE : TFT_DARKGREY;
+    _draw(DRAW_RECT, x, y, bw, bh, 0, color);
+    _draw(DRAW_FILL_RECT, x+1, y+1, bw-2, bh-2, 0, TFT_BLACK);
+    _drawn_clear_port(index / 4);
   }
   else
   // draw virtual led in port
   {
-    // get the invert config for the last pin of this port (that is what the event 
-    // is generated on and where the invert config needs to be set)
-    uint8_t mcp = port / 4;
-    uint8_t pin = ((port % 4) * 4) + 3;    
-    int invert = bitRead(_pin_invert[mcp], pin);
-    int disabled = bitRead(_pin_disabled[mcp], pin);
-    
-    // NOTE: we only invert the NORMAL/ALARM states, not the alert states
-    switch (state)
+    // the led shows this state already
+    if (_drawn_in[index] == state) return;
+    _drawn_in[index] = state;
+    _drawn_security[index / 4] = LED_DRAWN_NONE;
+
+    color = color_map[state];
+    switch (index % 4)
     {
-      case (B00000101):
-        color = color_map[invert ? 1 : 0]; 
-        flash = false;
+      case 0:
+        x = x+2;      y = y+2;
+        break;
+      case 1:
+        x = x+2;      y = y+bh/2+1;
         break;
-      case (B00000001):
-        color = color_map[invert ? 0 : 1]; 
-        flash = false;
+      case 2:
+        x = x+1+bw/2; y = y+2;
         break;
-      case (B00000010):
-      case (B00001101):
-        color = color_map[2]; 
-        flash = true;
+      case 3:
+        x = x+1+bw/2; y = y+bh/2+1;
         break;
-      default:
-        color = color_map[3]; 
-        flash = true;
     }
+    // the black of the port under the round corners as well, so the led is
+    // an area the draw list paints completely
+    _draw(DRAW_FILL_RECT, x, y, bw/2-2, bh/2-2, 0, TFT_BLACK);
+    _draw(DRAW_FILL_ROUND_RECT, x, y, bw/2-2, bh/2-2, 2, color);
+  }     
+}
 
-    if (disabled)
-    {
-      color = TFT_BLACK;
+/**
+  // Security sensor logic table (using our internal state constants)
+  //
+  // Sensor     CH4   CH3   CH2   CH1       State           Event
+  // -------------------------------------------------------------------
+  // NORMAL     ON    OFF   ON    OFF   =>  IS_HIGH         HIGH_EVENT          B00000101   GREEN
+  // ALARM      ON    ON    ON    OFF   =>  IS_LOW          LOW_EVENT           B00000001   RED
+  // TAMPER     ON    ON    OFF   ON    =>  DEBOUNCE_LOW    TAMPER_EVENT        B00000010   MAGENTA
+  // SHORT      OFF   OFF   ON    OFF   =>  DEBOUNCE_HIGH   SHORT_EVENT         B00001101   MAGENTA
+  //                                                        FAULT_EVENT         all other   CYAN
+**/
+// colour of a security port LED in state, see color_map of _update_security
+uint8_t OXRS_LCD::_security_shade(uint8_t port, int state, bool& flash)
+{
+  // get the invert config for the last pin of this port (that is what the event 
+  // is generated on and where the invert config needs to be set)
+  uint8_t mcp = port / 4;
+  uint8_t pin = ((port % 4) * 4) + 3;    
+  int invert = bitRead(_pin_invert[mcp], pin);
+  int disabled = bitRead(_pin_disabled[mcp], pin);
+  uint8_t shade;
+  
+  // NOTE: we only invert the NORMAL/ALARM states, not the alert states
+  switch (state)
+  {
+    case (B00000101):
+      shade = invert ? 1 : 0; 
       flash = false;
-    } 
-    else if (state == 0xff) 
-    {
-      color = TFT_DARKGREY;
-    }
-    
-    tft.fillRoundRect(x+2, y+2, bw-4, bh-4, 3, color);
+      break;
+    case (B00000001):
+      shade = invert ? 0 : 1; 
+      flash = false;
+      break;
+    case (B00000010):
+    case (B00001101):
+      shade = 2; 
+      flash = true;
+      break;
+    default:
+      shade = 3; 
+      flash = true;
+  }
+
+  if (disabled)
+  {
+    shade = 4;
+    flash = false;
+  } 
+  else if (state == 0xff) 
+  {
+    shade = 5;
+  }
+  return shade;
+}
+
+void OXRS_LCD::_update_security(uint8_t type, uint8_t port, int state)
+{
+  render_stat_scope stat(_render_stats.update_security);
 
+  // NORMAL, ALARM, TAMPER or SHORT, NC, FAULT, then disabled and unknown
+  uint16_t color_map[6] = {TFT_GREEN, TFT_RED, TFT_MAGENTA, TFT_CYAN, TFT_BLACK, TFT_DARKGREY};
+  
+  int bw =  _layout_config_in.bw;
+  int bh =  _layout_config_in.bh;
+  uint16_t color;
+  uint8_t shade;
+  bool flash;
+
+  // calculate the max (1-based) index for this port and check 
+  if (((port * 4) + 4) > _layout_config_in.index_max) return;
+  
+  int x = _cells_in[port].x;
+  int y = _cells_in[port].y;
+
+  if (type == TYPE_FRAME)
+  // draw port frame
+  {
+    color = (state != PORT_STATE_NA) ? TFT_WHITE : TFT_DARKGREY;
+    _draw(DRAW_RECT, x, y, bw, bh, 0, color);
+
+    _draw(DRAW_FILL_RECT, x+1, y+1, bw-2, bh-2, 0, TFT_BLACK);
+    _draw(DRAW_FILL_ROUND_RECT, x+2, y+2, bw-4, bh-4, 3, TFT_DARKGREY);
+    _drawn_clear_port(port);
+  }
+  else
+  // draw virtual led in port
+  {
+    shade = _security_shade(port, state, flash);
     bitWrite(_ports_to_flash, port, flash);
+
+    // the led shows this colour already
+    if (_drawn_security[port] == shade) return;
+    _drawn_clear_port(port);
+    _drawn_security[port] = shade;
+    color = color_map[shade];
+    
+    // black of the port under the round corners, see _update_input
+    _draw(DRAW_FILL_RECT, x+2, y+2, bw-4, bh-4, 0, TFT_BLACK);
+    _draw(DRAW_FILL_ROUND_RECT, x+2, y+2, bw-4, bh-4, 3, color);
   }     
 }
 
@@ -1216,55 +3173,48 @@ void OXRS_LCD::_update_security(uint8_t type, uint8_t port, int state)
  */
 void OXRS_LCD::_update_output(uint8_t type, uint8_t index, int state)
 {  
-  int bw =  _layout_config.bw;
-  int bh =  _layout_config.bh;
-  int xo =  _layout_config.xo;
-  int x =   _layout_config.x;
-  int y =   _layout_config.y;
+  render_stat_scope stat(_render_stats.update_output);
+
+  int bw =  _layout_config_out.bw;
+  int bh =  _layout_config_out.bh;
   uint16_t color;
-  int index_mod;
 
-  if (index > _layout_config.index_max) return;
+  if (index > _layout_config_out.index_max) return;
 
   index -= 1;
-  index_mod = index % 32;
-  
-  y = y + ((index / 32) * (bh + 2));
-  if (_mcp_output_pins == 16)
-  {
-    xo = xo + ((index_mod / 8) * 2) + ((index_mod / _mcp_output_pins) * 2);
-  }
-  else
-  {
-    xo = xo + ((index_mod / 8) * 2);
-  }
-  x = xo + (index_mod * (bw - 1));
+  int x = _cells_out[index].x;
+  int y = _cells_out[index].y;
 
   if (type == TYPE_FRAME)
   // draw port frame
   {
     color = (state != PORT_STATE_NA) ? TFT_WHITE : TFT_DARKGREY;
-    tft.drawRect(x, y, bw, bh, color);
+    _draw(DRAW_RECT, x, y, bw, bh, 0, color);
   }
   else
   // draw virtual led in port
   {
-    tft.fillRect(x+1, y+1, bw-2, bh-2, TFT_BLACK);
+    // the led shows this state already
+    if (_drawn_out[index] == state) return;
+    _drawn_out[index] = state;
+
+    _draw(DRAW_FILL_RECT, x+1, y+1, bw-2, bh-2, 0, TFT_BLACK);
     switch (state) 
     {
       case PORT_STATE_NA:
-        tft.drawRect(x+2, y+bh/2+2, bw-4, bh/2-4,  TFT_DARKGREY);
+        _draw(DRAW_RECT, x+2, y+bh/2+2, bw-4, bh/2-4, 0, TFT_DARKGREY);
         break;
       case PORT_STATE_OFF:
-        tft.fillRect(x+2, y+bh/2+2, bw-4, bh/2-4,  TFT_LIGHTGREY);
+        _draw(DRAW_FILL_RECT, x+2, y+bh/2+2, bw-4, bh/2-4, 0, TFT_LIGHTGREY);
         break;
       case PORT_STATE_ON:
-        tft.fillRect(x+1, y+1,      bw-2, bh-2,  TFT_RED);
+        _draw(DRAW_FILL_RECT, x+1, y+1,      bw-2, bh-2, 0, TFT_RED);
         break;
     }
   }     
 }
 
+#ifndef OXRS_LCD_NO_IO_48
 /**
   animation of input and output state in ports view
   Ports:    | 1 | 3 | 5 | 7 |     Index:      | 1 : 2 | 7 : 8 |    function:  | O : O |
@@ -1284,16 +3234,17 @@ void OXRS_LCD::_update_output(uint8_t type, uint8_t index, int state)
 */
 void OXRS_LCD::_update_io_48(uint8_t type, uint8_t index, int state)
 {  
-  int bw =  _layout_config.bw;
-  int bh =  _layout_config.bh;
-  int xo =  _layout_config.xo;
-  int x =   _layout_config.x;
-  int y =   _layout_config.y;
+  render_stat_scope stat(_render_stats.update_io_48);
+
+  int bw =  _layout_config_in.bw;
+  int bh =  _layout_config_in.bh;
   int bht = bh-bw/2;
   int port;
   int i;
   uint16_t color;
 
+  if (index > _layout_config_in.index_max) return;
+
   index -= 1;
   i = index;
   if (i < 16)
@@ -1306,38 +3257,44 @@ void OXRS_LCD::_update_io_48(uint8_t type, uint8_t index, int state)
     index = (i / 2) * 3 + i % 2; 
   }
   port = index / 3;
-  y = y + (port % 2) * bh;
-  xo = xo + (port / 8) * 3;
-  x = xo + (port / 2) * bw;
+  int x = _cells_in[port].x;
+  int y = _cells_in[port].y;
 
   if (type == TYPE_FRAME)
   // draw port fame
   {
     color = (state != PORT_STATE_NA) ? TFT_WHITE : TFT_DARKGREY;
-    tft.drawRect(x, y, bw, bh, color);
-    tft.drawRect(x, y, bw/2+1, bht, color);
-    tft.drawRect(x+bw/2, y, bw/2+1, bht, color);
+    _draw(DRAW_RECT, x, y, bw, bh, 0, color);
+    _draw(DRAW_RECT, x, y, bw/2+1, bht, 0, color);
+    _draw(DRAW_RECT, x+bw/2, y, bw/2+1, bht, 0, color);
+    _drawn_clear_port(port);
   }
   else
   // draw virtual led in port
   {
+    // the led shows this state already, on or not
+    uint8_t drawn = (state == PORT_STATE_ON);
+    if (_drawn_in[port * 4 + index % 3] == drawn) return;
+    _drawn_in[port * 4 + index % 3] = drawn;
+
     switch (index % 3)
     {
       case 0:
         color = (state == PORT_STATE_ON) ? TFT_RED : TFT_DARKGREY; 
-        tft.fillRect(x+1     , y+1      , bw/2-1, bht-2, color);
+        _draw(DRAW_FILL_RECT, x+1     , y+1      , bw/2-1, bht-2, 0, color);
         break;
       case 1:
         color = (state == PORT_STATE_ON) ? TFT_RED : TFT_DARKGREY; 
-        tft.fillRect(x+1+bw/2, y+1      , bw/2-1, bht-2, color);
+        _draw(DRAW_FILL_RECT, x+1+bw/2, y+1      , bw/2-1, bht-2, 0, color);
         break;
       case 2:
         color = (state == PORT_STATE_ON) ? TFT_YELLOW : TFT_DARKGREY;
-        tft.fillRoundRect(x+2     , y+bht+1 , bw/2-3, bh-bht-3, 3, color);
+        _draw(DRAW_FILL_ROUND_RECT, x+2     , y+bht+1 , bw/2-3, bh-bht-3, 3, color);
         break;
     }
   }     
 }
+#endif
 
 /*
  * set backlight of LCD (val in % [0..100])
@@ -1354,6 +3311,7 @@ void OXRS_LCD::_set_ip_link_led(int state)
 {
   // UP, DOWN, UNKNOWN
   uint16_t color[3] = {TFT_GREEN, TFT_RED, TFT_BLACK};
+  if (_diag_shown) return;
   if (state < 3) tft.fillRoundRect(2, _yIP+4, 8, 5, 2, color[state]);
 }
 
@@ -1361,6 +3319,7 @@ void OXRS_LCD::_set_mqtt_rx_led(int state)
 {
   // UP, ACTIVE, DOWN, UNKNOWN
   uint16_t color[4] = {TFT_GREEN, TFT_YELLOW, TFT_RED, TFT_BLACK};  
+  if (_diag_shown) return;
   if (state < 4) tft.fillRoundRect(2, _yMQTT, 8, 5, 2, color[state]);
 }
 
@@ -1368,12 +3327,14 @@ void OXRS_LCD::_set_mqtt_tx_led(int state)
 {
   // UP, ACTIVE, DOWN, UNKNOWN
   uint16_t color[4] = {TFT_GREEN, TFT_ORANGE, TFT_RED, TFT_BLACK};
+  if (_diag_shown) return;
   if (state < 4) tft.fillRoundRect(2, _yMQTT+8, 8, 5, 2, color[state]);
 }
 
 /*
  * Bodmers BMP image rendering function
  */
+#ifndef OXRS_LCD_NO_BMP_FILE
 // render logo from file in SPIFFS
 bool OXRS_LCD::_drawBmp(const char *filename, int16_t x, int16_t y, int16_t bmp_w, int16_t bmp_h) 
 {
@@ -1412,11 +3373,15 @@ bool OXRS_LCD::_drawBmp(const char *filename, int16_t x, int16_t y, int16_t bmp_
       file.seek(seekOffset);
 
       uint16_t padding = (4 - ((w * 3) & 3)) & 3;
-      uint8_t lineBuffer[w * 3 + padding];
+      // two rows, one is converted while the other is pushed by the transport
+      uint8_t lineBuffers[2][w * 3 + padding];
+      write_scope write(*this);
+      if (_transport) _write_open();
 
       for (row = 0; row < h; row++)
       {
-        file.read(lineBuffer, sizeof(lineBuffer));
+        uint8_t * lineBuffer = lineBuffers[row & 1];
+        file.read(lineBuffer, sizeof(lineBuffers[0]));
         uint8_t*  bptr = lineBuffer;
         uint16_t* tptr = (uint16_t*)lineBuffer;
         // Convert 24 to 16 bit colours
@@ -1431,8 +3396,11 @@ bool OXRS_LCD::_drawBmp(const char *filename, int16_t x, int16_t y, int16_t bmp_
         // Push the pixel row to screen, pushImage will crop the line if needed
         // y is decremented as the BMP image is drawn bottom up
         // crop to bmp_w
-        tft.pushImage(x, y--, bmp_w, 1, (uint16_t*)lineBuffer);
+        if (!_push_bmp_row((uint16_t*)lineBuffer, x, y, bmp_w)) tft.pushImage(x, y, bmp_w, 1, (uint16_t*)lineBuffer);
+        y--;
       }
+      // the rows are on the stack, the last push has to be sent before they go
+      if (_transport) _transport->wait();
       tft.setSwapBytes(oldSwapBytes);
 
       file.close();
@@ -1465,6 +3433,7 @@ uint32_t OXRS_LCD::_read32(File &f)
   ((uint8_t *)&result)[3] = f.read(); // MSB
   return result;
 }
+#endif
 
 // render logo from array in PROGMEM
 bool OXRS_LCD::_drawBmp_P(const uint8_t *image, int16_t x, int16_t y, int16_t bmp_w, int16_t bmp_h) 
@@ -1495,12 +3464,16 @@ bool OXRS_LCD::_drawBmp_P(const uint8_t *image, int16_t x, int16_t y, int16_t bm
       ptr = (uint8_t*)image + seekOffset;
 
       uint16_t padding = (4 - ((w * 3) & 3)) & 3;
-      uint8_t lineBuffer[w * 3 + padding];
+      // two rows, one is converted while the other is pushed by the transport
+      uint8_t lineBuffers[2][w * 3 + padding];
+      write_scope write(*this);
+      if (_transport) _write_open();
 
       for (row = 0; row < h; row++)
       {
-        memcpy_P(lineBuffer, ptr, sizeof(lineBuffer));
-        ptr += sizeof(lineBuffer);
+        uint8_t * lineBuffer = lineBuffers[row & 1];
+        memcpy_P(lineBuffer, ptr, sizeof(lineBuffers[0]));
+        ptr += sizeof(lineBuffers[0]);
         uint8_t*  bptr = lineBuffer;
         uint16_t* tptr = (uint16_t*)lineBuffer;
         // Convert 24 to 16 bit colours
@@ -1515,8 +3488,11 @@ bool OXRS_LCD::_drawBmp_P(const uint8_t *image, int16_t x, int16_t y, int16_t bm
         // Push the pixel row to screen, pushImage will crop the line if needed
         // y is decremented as the BMP image is drawn bottom up
         // crop to bmp_w
-        tft.pushImage(x, y--, bmp_w, 1, (uint16_t*)lineBuffer);
+        if (!_push_bmp_row((uint16_t*)lineBuffer, x, y, bmp_w)) tft.pushImage(x, y, bmp_w, 1, (uint16_t*)lineBuffer);
+        y--;
       }
+      // the rows are on the stack, the last push has to be sent before they go
+      if (_transport) _transport->wait();
 
       tft.setSwapBytes(oldSwapBytes);
       return true;
@@ -6,16 +6,48 @@
 #ifndef OXRS_LCD_H
 #define OXRS_LCD_H
 
+/*
+ * compile-time opt-outs, for builds that never use a feature
+ * define in the build flags, e.g. -D OXRS_LCD_NO_WIFI
+ *
+ *   OXRS_LCD_NO_ETHERNET     no ethernet constructor
+ *   OXRS_LCD_NO_WIFI         no wifi constructor
+ *   OXRS_LCD_NO_BMP_FILE     drawHeader() does not look for /logo.bmp on LittleFS
+ *   OXRS_LCD_NO_IO_48        no PORT_LAYOUT_IO_48 (drawPorts() leaves the ports empty)
+ *   OXRS_LCD_NO_FONT_MONO    showEvent() never uses the FONT_MONO free font (FMB9)
+ *   OXRS_LCD_NO_FONT_PROP    showEvent() never uses the FONT_PROP free font (FSSB9)
+ *   OXRS_LCD_NO_LED_TILES    no setLedTiles(), LED cells are rasterised on every change
+ *   OXRS_LCD_NO_RENDER_STATS process(), loop() and the painters are not timed (getRenderStats()
+ *                            keeps only the latency, the diagnostics page shows no SPI load)
+ *
+ * without either event font, events are shown in the font of the info lines
+ */
+#if defined(OXRS_LCD_NO_ETHERNET) && defined(OXRS_LCD_NO_WIFI)
+#error "OXRS_LCD needs ethernet or wifi, do not define both OXRS_LCD_NO_ETHERNET and OXRS_LCD_NO_WIFI"
+#endif
+
 #include <TFT_eSPI.h>               // Hardware-specific library
 #include <OXRS_MQTT.h>
+#include "OXRS_LCD_draw_list.h"     // deferred port drawing
+#include "OXRS_LCD_geometry.h"      // port cell positions
+#include "OXRS_LCD_transport.h"     // pixel pushes by DMA
+#include "OXRS_LCD_queue.h"         // render queue of the render task
+
+#ifndef OXRS_LCD_NO_ETHERNET
 #include <Ethernet.h>
+#endif
+
+#ifndef OXRS_LCD_NO_BMP_FILE
 #include <LittleFS.h>
+#endif
 
+#ifndef OXRS_LCD_NO_WIFI
 #if defined(ESP8266)
 #include <ESP8266WiFi.h>
 #else
 #include <WiFi.h>
 #endif
+#endif
 
 #define     TYPE_FRAME                  0
 #define     TYPE_STATE                  1
@@ -97,6 +129,75 @@
 #define     LCD_INFO_LOGO_DEFAULT       103   // used default OXRS logo
 #define     LCD_ERR_NO_LOGO             1     // no logo successfully rendered
 
+// io trace recording (see startRecording)
+#define     IO_TRACE_MAGIC              "OXIO"
+#define     IO_TRACE_VERSION            1
+#define     IO_TRACE_CONFIG             0x08  // record flag, pin config follows instead of io_value
+
+// render statistics (see getRenderStats)
+// bucket 0 counts calls under 1 us, bucket n calls of 2^(n-1) .. 2^n-1 us,
+// the last bucket also everything longer
+#define     RENDER_STATS_BUCKETS        16
+
+// pin change to painted latency histogram (see getLatencyPercentile)
+// exact below 8 us, then 8 buckets per power of 2 (within 12.5 %) up to 1 s
+#define     LATENCY_BUCKETS             144
+
+// diagnostics page (see showDiagnostics), shown in place of the info section
+#define     DIAG_WINDOW_MS              1000      // figures are averaged over this window
+#define     DIAG_H                      60        // rows taken from Y_INFO down
+
+// shadow buffer of the port area (see setShadowBuffer)
+#define     SHADOW_OFF                  0
+#define     SHADOW_RGB565               1         // 16 bit, 53 KB, from PSRAM with BOARD_HAS_PSRAM
+#define     SHADOW_PALETTE              2         // 4 bit of up to 16 colours, 13 KB
+#define     SHADOW_Y                    111       // rows SHADOW_Y .. SHADOW_Y+SHADOW_H-1 hold every layout
+#define     SHADOW_H                    112
+#define     SHADOW_TILE                 16        // tiles of 16x16 pixels are hashed and pushed when changed
+#define     SHADOW_TILES_X              (240 / SHADOW_TILE)
+#define     SHADOW_TILES                (SHADOW_TILES_X * (SHADOW_H / SHADOW_TILE))
+#define     SHADOW_WINDOW_PIXELS        16        // about the bus time of opening an address window
+
+// LED cells rendered before, copied instead of rasterised again (see setLedTiles)
+#define     LED_TILES                   8
+#define     LED_TILE_PIXELS             384       // the largest cell, 21x17 of an output LED, fits
+#define     LED_TILE_CMDS               4
+
+// render budget of loop() (see setRenderBudget)
+#define     RENDER_BUDGET_US            0         // none, every pending LED in each loop()
+#define     SCHEDULE_CHUNK              8         // LEDs painted per flush
+
+// status paints left to loop() with a render budget (_pending_status)
+#define     PENDING_RX_LED              0
+#define     PENDING_TX_LED              1
+#define     PENDING_EVENT               2
+#define     PENDING_EVENT_CLEAR         3
+
+// boot screen drawn by loop() (see startDrawPorts)
+#define     DRAW_SLICE_US               2000      // per loop() without a render budget
+#define     HEADER_SLICES               2         // the logo, the text
+
+// render task (see startRenderTask), on the core the Arduino loop() leaves
+// to WiFi and at its priority. woken by each record, and at least every
+// RENDER_TASK_IDLE_MS for the timers of loop(). its stack holds the pushes
+// of _flush_shadow (1 KB), the row buffers of draw_list::render and the
+// float formatting of showTemp()
+#define     RENDER_TASK_CORE            0
+#define     RENDER_TASK_PRIORITY        1
+#define     RENDER_TASK_STACK           8192
+#define     RENDER_TASK_IDLE_MS         10
+
+// what an LED shows is not known, the next paint of it is drawn (see _drawn_clear)
+#define     LED_DRAWN_NONE              0xff
+
+typedef struct LED_TILE
+  {
+    int16_t  w, h;                    // 0 while unused
+    uint8_t  count;
+    draw_cmd cmds[LED_TILE_CMDS];     // relative to the tile
+    uint16_t pixels[LED_TILE_PIXELS];
+  } led_tile;
+
 typedef struct LAYOUT_CONFIG 
   {
     int x;
@@ -106,16 +207,121 @@ typedef struct LAYOUT_CONFIG
     int bh;
     int index_max;
   } layout_config;
+
+typedef struct RENDER_STAT
+  {
+    uint32_t count;
+    uint32_t total_us;
+    uint32_t max_us;
+    uint32_t histogram[RENDER_STATS_BUCKETS];
+  } render_stat;
+
+typedef struct LATENCY_STAT
+  {
+    uint32_t count;
+    uint32_t max_us;
+    uint32_t histogram[LATENCY_BUCKETS];
+  } latency_stat;
+
+// time spent per call, process() includes the painters it calls
+typedef struct RENDER_STATS
+  {
+    uint32_t      since_ms;         // millis() of the last reset
+    latency_stat  latency;          // from process() seeing a pin change to its port painted
+    render_stat   process;
+    render_stat   loop;
+    render_stat   update_input;
+    render_stat   update_output;
+    render_stat   update_io_48;
+    render_stat   update_security;
+    render_stat   flush_draws;      // the painters only queue, this draws
+    uint32_t      queue_dropped;    // rx/tx LED and event records the render queue had no room for,
+                                    // and any record while the render side had stalled
+  } render_stats;
+
+// the states the LEDs pending with a render budget are to show (see setRenderBudget)
+typedef struct BUDGET_WANTS
+  {
+    uint8_t         security[32];
+    uint8_t         in[128];
+    uint8_t         out[128];
+    uint8_t         rx_led;
+    uint8_t         tx_led;
+    int             event_font;
+    lcd_event_text  event;
+  } budget_wants;
+
+// the rings of the render queue (see OXRS_LCD_queue.h) and what the render
+// side keeps of them, allocated by setRenderQueue(true)
+typedef struct RENDER_QUEUE
+  {
+    lcd_ring<lcd_record, RENDER_QUEUE_RECORDS>    records;
+    lcd_ring<lcd_event_text, RENDER_QUEUE_EVENTS> events;
+    lcd_ring<lcd_link, RENDER_QUEUE_LINKS>        links;
+    lcd_ring<Print *, RENDER_QUEUE_RECORDERS>     recorders;
+    lcd_link      link;             // the last one popped, as drawn
+    render_stats  stats[2];         // _render_stats as of RECORD_STATS, by _stats_done & 1
+  } render_queue;
+
+#ifndef OXRS_LCD_NO_RENDER_STATS
+// adds the time from construction to destruction to a render_stat
+class render_stat_scope
+{
+  public:
+    render_stat_scope(render_stat& stat) : _stat(stat), _start(micros()) {}
+    ~render_stat_scope()
+    {
+      uint32_t us = micros() - _start;
+      int bucket = us ? 32 - __builtin_clz(us) : 0;
+      if (bucket >= RENDER_STATS_BUCKETS) bucket = RENDER_STATS_BUCKETS - 1;
+
+      _stat.count++;
+      _stat.total_us += us;
+      if (us > _stat.max_us) _stat.max_us = us;
+      _stat.histogram[bucket]++;
+    }
+
+  private:
+    render_stat& _stat;
+    uint32_t     _start;
+};
+#else
+class render_stat_scope
+{
+  public:
+    render_stat_scope(render_stat&) {}
+};
+#endif
+
+// figures of the diagnostics page, per DIAG_WINDOW_MS
+typedef struct DIAG_VALUES
+  {
+    uint32_t loop_hz;               // loop() calls per second
+    uint32_t loop_max_us;           // longest loop()
+    uint32_t spi_pct;               // time the port draws kept the bus busy
+    uint32_t flashing;              // security ports flashing
+    uint32_t changes[8];            // pin changes per second, per MCP
+  } diag_values;
   
 class OXRS_LCD
 {
   public:
+#ifndef OXRS_LCD_NO_ETHERNET
     OXRS_LCD(EthernetClass& ethernet, OXRS_MQTT& mqtt);
+#endif
+#ifndef OXRS_LCD_NO_WIFI
     OXRS_LCD(WiFiClass& wifi, OXRS_MQTT& mqtt);
+#endif
+    ~OXRS_LCD();
     
     int drawHeader(const char * fwShortName, const char * fwMaker, const char * fwVersion, const char * fwPlatform, const uint8_t * fwLogo = NULL);
     void drawPorts(int port_layout, uint8_t mcps_found);
 
+    void startDrawHeader(const char * fwShortName, const char * fwMaker, const char * fwVersion, const char * fwPlatform, const uint8_t * fwLogo = NULL);
+    void startDrawPorts(int port_layout, uint8_t mcps_found);
+    bool screenDrawn(void);
+    int  getHeaderResult(void);
+
     void begin(void);
     void process(uint8_t mcp, uint16_t io_value);
     void loop(void);
@@ -143,8 +349,96 @@ class OXRS_LCD
     
     TFT_eSPI* getTft(void);
 
+    void startRecording(Print * out);
+    void stopRecording(void);
+
+    const render_stats& getRenderStats(void);
+    void resetRenderStats(void);
+    uint32_t getLatencyPercentile(int percentile);
+
+    void showDiagnostics(bool show);
+    bool diagnosticsShown(void);
+
+    bool setShadowBuffer(int mode);
+    int  getShadowBuffer(void);
+
+    bool setLedTiles(bool tiles);
+    bool getLedTiles(void);
+
+    bool setTransport(lcd_transport * transport);
+
+    void setRenderBudget(uint32_t budget_us);
+    int  getPendingRepaints(void);
+
+    bool setRenderQueue(bool queue);
+    void drainRenderQueue(void);
+#if defined(ESP32)
+    bool startRenderTask(int core = RENDER_TASK_CORE, int priority = RENDER_TASK_PRIORITY);
+    void stopRenderTask(void);
+#endif
+
+
+  private:
+#ifdef OXRS_LCD_HOST
+    // the host benchmarks time single painters (tools/host/bench_access.h)
+    friend struct bench_access;
+#endif
+
+    render_stats _render_stats;
+
+    // a pass that may paint: the SPI transaction (CS held low) begun by the
+    // first _write_open() in it lasts to the end of the outermost scope, the
+    // primitives drawn meanwhile do not begin and end their own. a pass that
+    // paints nothing costs no transaction. never across Ethernet calls, the
+    // W5500 of the RACK32 shares the bus (MOSI 23, SCLK 18)
+    class write_scope
+    {
+      public:
+        write_scope(OXRS_LCD& lcd) : _lcd(lcd) { _lcd._write_depth++; }
+        ~write_scope() { _lcd._write_end(); }
+
+      private:
+        OXRS_LCD& _lcd;
+    };
+    int  _write_depth = 0;
+    bool _writing = false;
+    void _write_open(void);
+    void _write_end(void);
+
+    // process() of the firmware side with the render queue on: posted, or
+    // dropped as no change. false while the queue is off
+    bool _queue_process(uint8_t mcp, uint16_t io_value);
+
+    // process() in parts, around the pin loop of the layout group that
+    // drawPorts() binds (_process_pins_fn)
+    uint16_t _process_begin(uint8_t mcp, uint16_t io_value, int& index, int& pin_count, bool& forced, uint32_t& seen_us);
+    template <int GROUP>
+    int  _process_pins(uint8_t mcp, uint16_t changed, uint16_t io_value, int index, int pin_count);
+    void _process_end(uint8_t mcp, uint16_t io_value, int queued, bool forced, uint32_t seen_us);
+
+    void _pin_input(uint8_t mcp, int index, int pin, uint16_t io_value);
+    void _pin_output(uint8_t mcp, int index, int pin, uint16_t io_value);
+#ifndef OXRS_LCD_NO_IO_48
+    void _pin_io_48(uint8_t mcp, int index, int pin, uint16_t io_value);
+#endif
+    void _pin_hybrid(uint8_t mcp, int index, int pin, uint16_t io_value);
+
+    static constexpr int _getPortLayoutGroup(int port_layout)
+    {
+      return (port_layout / 1000 == 1) ? PORT_LAYOUT_GROUP_INPUT :
+             (port_layout / 1000 == 2) ? PORT_LAYOUT_GROUP_OUTPUT :
+             (port_layout / 1000 == 3) ? PORT_LAYOUT_GROUP_SMOKE :
+             (port_layout / 1000 == 4) ? PORT_LAYOUT_GROUP_HYBRID : 0;
+    }
+
+    void _update_input(uint8_t type, uint8_t index, int state);
+    void _update_output(uint8_t type, uint8_t index, int state);
+#ifndef OXRS_LCD_NO_IO_48
+    void _update_io_48(uint8_t type, uint8_t index, int state);
+#endif
+    void _update_security(uint8_t type, uint8_t index, int state);
+    uint8_t _security_shade(uint8_t port, int state, bool& flash);
 
-  private:  
     // for timeout (clear) of bottom line input event display
     uint32_t _last_event_display = 0L;
     
@@ -172,30 +466,110 @@ class OXRS_LCD
     int       _yTEMP  = Y_INFO + 45;
     
     
+#ifndef OXRS_LCD_NO_ETHERNET
     EthernetClass * _ethernet;
+#endif
+#ifndef OXRS_LCD_NO_WIFI
     WiFiClass *     _wifi;
+#endif
     int             _ip_state = -1;
     
     OXRS_MQTT *     _mqtt;
     int             _mqtt_state = -1;
     
     // defines how i/o ports are displayed and animated
-    int             _port_layout;
-    layout_config   _layout_config, _layout_config_in, _layout_config_out;
-    int             _mcp_output_pins;
-    int             _mcp_output_start;
+    int             _port_layout = 0;
+    // outline of the input and the output ports, set by drawPorts(). a layout
+    // with one kind of ports leaves the other zero
+    layout_config   _layout_config_in, _layout_config_out;
+    // _process_pins<GROUP> of the layout, bound by drawPorts()
+    typedef int (OXRS_LCD::*process_pins_fn)(uint8_t mcp, uint16_t changed, uint16_t io_value, int index, int pin_count);
+    process_pins_fn _process_pins_fn = &OXRS_LCD::_process_pins<0>;
+    // painters of the input and the output LEDs loop() has pending, bound by drawPorts()
+    typedef void (OXRS_LCD::*paint_fn)(uint8_t type, uint8_t index, int state);
+    paint_fn        _paint_in_fn = &OXRS_LCD::_update_input;
+    paint_fn        _paint_out_fn = &OXRS_LCD::_update_output;
+    // cells of the layout, built by drawPorts() (see OXRS_LCD_geometry.h)
+    port_cell       _cells_in[CELLS_IN];
+    port_cell       _cells_out[CELLS_OUT];
+    void _build_input_cells(bool wide);
+    void _build_output_cells(void);
+    int             _mcp_output_pins = 16;
+    int             _mcp_output_start = 8;
      
    // history buffer of io_values to extract changes
     uint16_t _io_values[8];
     
     uint16_t _mcps_initialised = 0;
-    int      _mcps_found;
+    int      _mcps_found = 0;
 
     uint16_t _pin_type[8];
     uint16_t _pin_invert[8];
     uint16_t _pin_disabled[8];
+
+    // io trace recording
+    Print *  _recorder = NULL;
+    uint32_t _last_record_ms = 0L;
+
+    // pin changes queued per MCP and when the first was seen, for the latency at the flush
+    uint16_t _latency_pending[8];
+    uint32_t _latency_seen_us[8];
+
+    // last temperature shown, restored when the diagnostics page is hidden
+    float    _temperature = NAN;
+    char     _temperature_unit = 'C';
+
+    // diagnostics page
+    bool        _diag_shown = false;
+    uint32_t    _diag_window_start = 0L;
+    uint32_t    _diag_loops = 0;
+    uint32_t    _diag_loop_max_us = 0;
+    uint32_t    _diag_busy_us = 0;
+    uint32_t    _diag_changes[8];
+    diag_values _diag_values, _diag_drawn;
     
+    // the public calls that paint, run by them or by the render side
+    void _process(uint8_t mcp, uint16_t io_value);
+    void _loop(void);
+    void _trigger_mqtt_rx_led(void);
+    void _trigger_mqtt_tx_led(void);
+    void _show_temp(float temperature, char unit);
+    void _show_event(const char * s_event, int font);
+    void _set_pin_type(uint8_t mcp, uint8_t pin, int type);
+    void _set_pin_invert(uint8_t mcp, uint8_t pin, int invert);
+    void _set_pin_disabled(uint8_t mcp, uint8_t pin, int disabled);
+    void _show_diagnostics(bool show);
+    void _start_recording(Print * out);
+    void _setting(uint8_t setting, int32_t value);
+    void _set_setting(uint8_t setting, int32_t value);
+    int  _pending_repaints(void);
+
     void _clear_event(void);
+
+    // drawHeader() and drawPorts() in slices, all in one call or one or more
+    // per loop() after startDrawHeader()/startDrawPorts()
+    const char *    _header_text[4];
+    const uint8_t * _header_logo;
+    int             _header_result = 0;
+    int             _header_slice = HEADER_SLICES;
+    uint8_t         _ports_mcps_found;
+    uint8_t         _ports_deferred = 0;
+    int             _ports_frame_h;
+    int             _ports_in_blocks;
+    int             _ports_slices = 0;
+    int             _ports_slice = 0;
+    void _header_begin(const char * fwShortName, const char * fwMaker, const char * fwVersion, const char * fwPlatform, const uint8_t * fwLogo);
+    void _draw_header_slice(void);
+    int  _draw_logo(const uint8_t * fwLogo);
+    void _ports_begin(int port_layout, uint8_t mcps_found);
+    void _draw_ports_slice(void);
+    bool _draw_slices(uint32_t start_us);
+    bool _screen_drawn(void);
+
+    void _add_latency(uint32_t us);
+
+    void _record_config(uint8_t mcp);
+    void _record(uint8_t mcp, uint8_t flags, const uint16_t * values, int count);
     
     byte * _get_MAC_address(byte * mac);
     IPAddress _get_IP_address(void);
@@ -210,25 +584,182 @@ class OXRS_LCD
     void _show_MQTT_topic(const char * topic);
 
     void _check_port_flash(void);
-    int  _getPortLayoutGroup(int port_layout);
 
-    void _update_input(uint8_t type, uint8_t index, int state);
-    void _update_output(uint8_t type, uint8_t index, int state);
-    void _update_io_48(uint8_t type, uint8_t index, int state);
-    void _update_security(uint8_t type, uint8_t index, int state);
+    // port painters queue here, see OXRS_LCD_draw_list.h
+    draw_list _draws;
+    uint16_t * _draw_pixels = NULL;   // allocated by begin()
+    uint16_t * _draw_buffer = NULL;   // rendered into, never in flight
+    void _draw(uint8_t kind, int x, int y, int w, int h, int r, uint16_t color);
+    void _draw_cmd(const draw_cmd& cmd);
+    bool _render(const draw_area& band);
+    // what every LED was last painted as, a painter asked for the same again
+    // queues nothing. input and IO_48 LEDs by port cell * 4 + LED
+    uint8_t   _drawn_in[CELLS_IN * 4];
+    uint8_t   _drawn_security[CELLS_IN];
+    uint8_t   _drawn_out[CELLS_OUT];
+    void _drawn_clear(void);
+    void _drawn_clear_port(int port);
+#ifndef OXRS_LCD_NO_LED_TILES
+    led_tile * _led_tiles = NULL;
+    int        _led_tile_next = 0;
+#endif
+    void _flush_draws(void);
+    bool _push_area(const draw_area& damaged);
+    bool _clip(draw_area& area);
+    draw_area _band(const draw_area& area, int y, int rows);
+
+    // LEDs of pin changes left to loop() (see setRenderBudget), by 0-based
+    // index (port for security), with the state each is to show
+    uint32_t        _budget_us = RENDER_BUDGET_US;
+    uint32_t        _pending_security;
+    uint32_t        _pending_in[4];
+    uint32_t        _pending_out[4];
+    // ... and of the MQTT rx/tx LEDs and the event bar
+    uint8_t         _pending_status;
+    budget_wants *  _wants = NULL;            // allocated while there is a budget
+    void _set_budget(uint32_t budget_us);
+    void _schedule_clear(void);
+    bool _scheduled(void);
+    bool _over_budget(uint32_t start_us);
+    void _schedule_security(uint8_t port, int state);
+    void _schedule_input(uint8_t index, int state);
+    void _schedule_output(uint8_t index, int state);
+#ifndef OXRS_LCD_NO_IO_48
+    void _schedule_io_48(uint8_t index, int state);
+#endif
+    void _schedule_rx_led(int state);
+    void _schedule_tx_led(int state);
+    void _schedule_event(const char * s_event, int font);
+    void _schedule_event_clear(void);
+    bool _schedule(uint32_t start_us);
+    int  _schedule_inputs(int count);
+    int  _schedule_outputs(int count);
+    int  _schedule_status(void);
+
+    // render queue (see OXRS_LCD_queue.h). _posted_... and _overflow_... are
+    // the firmware side's, _queued_... and _draining the render side's
+    bool            _queue_on = false;
+    render_queue *  _queue = NULL;            // allocated while the queue is on
+    uint16_t        _posted_io[8];
+    uint8_t         _posted_mcps = 0;         // MCPs with their last io_value in _posted_io
+    uint8_t         _overflow_mcps = 0;       // ... not posted yet, the queue was full
+    uint32_t        _overflow_us[8];
+    uint16_t        _posted_link = 0xffff;
+    bool            _posted_no_ip = false;    // link up, DHCP had not issued an IP yet
+    int             _queued_ip_state = -1;    // as drawn until loop() posts the first
+    int             _queued_mqtt_state = -1;
+    uint32_t        _queue_dropped = 0;       // records _post() had no room for
+    uint32_t        _stats_requested = 0;     // RECORD_STATS posted ...
+    std::atomic<uint32_t> _stats_done{0};     // ... and applied
+    std::atomic<uint32_t> _drains{0};         // records applied and passes ended by the render side
+    uint32_t        _waited_drains = 0;       // ... as last seen by a wait
+    bool            _render_stalled = false;  // a wait gave up, the next fail at once
+    bool            _draining = false;
+    uint32_t        _draining_us = 0;         // when the io_value being drained was seen
+    // what the getters read with the queue on, as of the last pass of the render side
+    std::atomic<bool> _shown_screen_drawn{false};
+    std::atomic<bool> _shown_diagnostics{false};
+    std::atomic<int>  _shown_header_result{0};
+    std::atomic<int>  _shown_shadow_mode{SHADOW_OFF};
+    std::atomic<int>  _shown_pending{0};
+#if defined(ESP32)
+    TaskHandle_t    _render_task = NULL;
+    std::atomic<bool> _render_stop{false};    // set by stopRenderTask() ...
+    std::atomic<bool> _render_stopped{false}; // ... and by the task once it has drained
+    static void _render_task_main(void * lcd);
+#endif
+    bool _post(uint8_t kind, uint8_t mcp = 0, uint16_t value = 0, uint32_t us = 0);
+    void _post_overflow(void);
+    void _post_link(void);
+    bool _request_stats(uint16_t value);
+    bool _render_waiting(uint32_t& spins);
+    void _render_wake(void);
+    void _render_shown(void);
+    void _apply(const lcd_record& record);
+
+    // pixel pushes through a transport (see OXRS_LCD_transport.h), the next
+    // block is rendered into the other buffer while one is sent
+    lcd_transport * _transport = NULL;
+    uint16_t *      _draw_buffer_next = NULL;
+    void _push_window(int x, int y, int w, int h);
+    void _push_pixels(uint16_t * pixels, uint32_t len);
+    void _push_buffer(uint32_t len);
+    bool _push_bmp_row(uint16_t * pixels, int16_t x, int16_t y, int16_t w);
+
+    // shadow of the port area, the pixels on the display
+    int        _shadow_mode = SHADOW_OFF;
+    uint8_t *  _shadow = NULL;
+    uint16_t   _palette[16];
+    int        _palette_size = 0;
+    uint32_t * _tile_hash = NULL;     // allocated with the shadow
+    void _shadow_off(void);
+    uint16_t _shadow_get(int x, int y);
+    bool     _shadow_set(int x, int y, uint16_t color);
+    uint32_t _shadow_hash(int tile);
+    bool     _flush_shadow(void);
+    void     _push_shadow(const draw_area& area);
+
+    void _check_diagnostics(uint32_t loop_us);
+    void _draw_diagnostics(void);
+    void _draw_diag_value(int col, int row, int width, uint32_t value, uint32_t& drawn);
 
     void _set_backlight(int val);
     void _set_ip_link_led(int state);
     void _set_mqtt_rx_led(int state);
     void _set_mqtt_tx_led(int state);
 
+#ifndef OXRS_LCD_NO_BMP_FILE
     bool _drawBmp(const char *filename, int16_t x, int16_t y, int16_t bmp_w, int16_t bmp_h);
     uint16_t _read16(File &f);
     uint32_t _read32(File &f);   
+#endif
 
     bool _drawBmp_P(const uint8_t *image, int16_t x, int16_t y, int16_t bmp_w, int16_t bmp_h);
     uint16_t _read16_P(uint8_t** p);
     uint32_t _read32_P(uint8_t** p);   
 };
 
+// the changed pins of an MCP to the port handlers of layout group GROUP,
+// returns the pins queued. GROUP is a constant, the other branches drop out
+template <int GROUP>
+int OXRS_LCD::_process_pins(uint8_t mcp, uint16_t changed, uint16_t io_value, int index, int pin_count)
+{
+  int queued = 0;
+
+  // walk thru all inputs, call _update_... if change detected
+  for (int i = 0; i < pin_count; i++)
+  {
+    // skip if nothing has changed
+    if (!bitRead(changed, i)) continue;
+
+    // only update the backlight if an active pin has changed
+    if (!bitRead(_pin_disabled[mcp], i))
+    {
+      _set_backlight(_brightness_on);
+      _last_lcd_trigger = millis();
+    }
+
+    switch (GROUP)
+    {
+      case PORT_LAYOUT_GROUP_INPUT:
+        _pin_input(mcp, index, i, io_value);
+        break;
+      case PORT_LAYOUT_GROUP_OUTPUT:
+        _pin_output(mcp, index, i, io_value);
+        break;
+#ifndef OXRS_LCD_NO_IO_48
+      case PORT_LAYOUT_GROUP_SMOKE:
+        _pin_io_48(mcp, index, i, io_value);
+        break;
+#endif
+      case PORT_LAYOUT_GROUP_HYBRID:
+        _pin_hybrid(mcp, index, i, io_value);
+        break;
+    }
+
+    queued++;
+  }
+  return queued;
+}
+
 #endif
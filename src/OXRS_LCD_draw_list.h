@@ -0,0 +1,285 @@
+/*
+ * OXRS_LCD_draw_list.h
+ * deferred drawing of the port painters
+ *
+ * the painters queue their primitives here instead of drawing them, a command
+ * whose pixels are all painted again by a later one is dropped on the way:
+ *
+ *   fillRect black, fillRect red on the same cell     -> fillRect red
+ *   fillRoundRect grey, fillRoundRect green (same)    -> fillRoundRect green
+ *
+ * the list also tracks the damaged screen areas, the bounding rects of the
+ * commands merged while they overlap or line up into a larger rect. an area
+ * whose pixels are all painted by its commands can be rendered into a buffer
+ * with render() and sent in one address window, instead of the many windows
+ * TFT_eSPI opens for outlines and round corners.
+ *
+ * the commands and areas are allocated by begin(), add() fails until then.
+ */
+
+#ifndef OXRS_LCD_DRAW_LIST_H
+#define OXRS_LCD_DRAW_LIST_H
+
+#include <Arduino.h>
+
+#define     DRAW_LIST_SIZE              128       // commands held until flushed
+#define     DRAW_BUFFER_PIXELS          1024      // render() limit, larger areas go in bands
+
+// draw command kinds
+#define     DRAW_NONE                   0         // dropped, painted over later
+#define     DRAW_RECT                   1
+#define     DRAW_FILL_RECT              2
+#define     DRAW_FILL_ROUND_RECT        3
+
+typedef struct DRAW_CMD
+  {
+    uint8_t  kind;
+    uint8_t  r;
+    int16_t  x, y, w, h;
+    uint16_t color;
+  } draw_cmd;
+
+typedef struct DRAW_AREA
+  {
+    int16_t  x, y, w, h;
+  } draw_area;
+
+class draw_list
+{
+  public:
+    draw_list() {}
+    draw_list(const draw_list&) = delete;
+    ~draw_list()
+    {
+      free(_cmds);
+      free(_areas);
+    }
+
+    // empty, false when the commands and areas cannot be allocated
+    bool begin(void)
+    {
+      if (!_cmds) _cmds = (draw_cmd *)malloc(DRAW_LIST_SIZE * sizeof(draw_cmd));
+      if (!_areas) _areas = (draw_area *)malloc(DRAW_LIST_SIZE * sizeof(draw_area));
+      clear();
+      return _cmds && _areas;
+    }
+
+    // queue a command, false when the list is full (flush and add again) or
+    // was not allocated
+    bool add(uint8_t kind, int16_t x, int16_t y, int16_t w, int16_t h, uint8_t r, uint16_t color)
+    {
+      if (!_cmds || !_areas) return false;
+      if (_count == DRAW_LIST_SIZE) _compact();
+      if (_count == DRAW_LIST_SIZE) return false;
+
+      draw_cmd cmd = {kind, r, x, y, w, h, color};
+      for (int i = 0; i < _count; i++)
+      {
+        if (_cmds[i].kind != DRAW_NONE && _covers(cmd, _cmds[i])) _cmds[i].kind = DRAW_NONE;
+      }
+      _cmds[_count++] = cmd;
+
+      _damage(x, y, w, h);
+      return true;
+    }
+
+    // commands in order, skip DRAW_NONE
+    int count(void) const { return _count; }
+    const draw_cmd& operator[](int i) const { return _cmds[i]; }
+
+    // damaged areas, they do not overlap and every command lies in one of them
+    int areas(void) const { return _area_count; }
+    const draw_area& area(int i) const { return _areas[i]; }
+
+    static bool inside(const draw_cmd& cmd, const draw_area& area)
+    {
+      return _inside(cmd, area.x, area.y, area.w, area.h);
+    }
+
+    // pixels of area (at most DRAW_BUFFER_PIXELS) as the commands leave them,
+    // false when one of them is not painted by any command
+    bool render(const draw_area& area, uint16_t * pixels)
+    {
+      uint8_t painted[DRAW_BUFFER_PIXELS / 8];
+      int size = area.w * area.h;
+      if (size > DRAW_BUFFER_PIXELS) return false;
+
+      _target = pixels;
+      _painted = painted;
+      _clip = area;
+      memset(painted, 0, (size + 7) / 8);
+
+      for (int i = 0; i < _count; i++)
+      {
+        const draw_cmd& cmd = _cmds[i];
+        if (cmd.x >= area.x + area.w || cmd.y >= area.y + area.h ||
+            cmd.x + cmd.w <= area.x || cmd.y + cmd.h <= area.y) continue;
+
+        // the same pixels TFT_eSPI would paint
+        switch (cmd.kind)
+        {
+          case DRAW_RECT:
+            _hline(cmd.x, cmd.y, cmd.w, cmd.color);
+            _hline(cmd.x, cmd.y + cmd.h - 1, cmd.w, cmd.color);
+            _vline(cmd.x, cmd.y + 1, cmd.h - 2, cmd.color);
+            _vline(cmd.x + cmd.w - 1, cmd.y + 1, cmd.h - 2, cmd.color);
+            break;
+          case DRAW_FILL_RECT:
+            _fill(cmd.x, cmd.y, cmd.w, cmd.h, cmd.color);
+            break;
+          case DRAW_FILL_ROUND_RECT:
+            _fill(cmd.x, cmd.y + cmd.r, cmd.w, cmd.h - cmd.r - cmd.r, cmd.color);
+            _corners(cmd.x + cmd.r, cmd.y + cmd.h - cmd.r - 1, cmd.r, 1, cmd.w - cmd.r - cmd.r - 1, cmd.color);
+            _corners(cmd.x + cmd.r, cmd.y + cmd.r, cmd.r, 2, cmd.w - cmd.r - cmd.r - 1, cmd.color);
+            break;
+        }
+      }
+
+      for (int i = 0; i < size / 8; i++)
+      {
+        if (painted[i] != 0xff) return false;
+      }
+      for (int i = size & ~7; i < size; i++)
+      {
+        if (!(painted[i / 8] & (1 << (i % 8)))) return false;
+      }
+      return true;
+    }
+
+    void clear(void) { _count = 0; _area_count = 0; }
+
+  private:
+    draw_cmd *  _cmds = NULL;
+    int         _count = 0;
+
+    draw_area * _areas = NULL;
+    int         _area_count = 0;
+
+    // render() target
+    uint16_t * _target;
+    uint8_t *  _painted;
+    draw_area  _clip;
+
+    // later paints every pixel of earlier: the same shape, or earlier inside
+    // a solid part of later (a round rect is solid in its two inner bands)
+    static bool _covers(const draw_cmd& later, const draw_cmd& earlier)
+    {
+      if (later.kind == earlier.kind && later.x == earlier.x && later.y == earlier.y &&
+          later.w == earlier.w && later.h == earlier.h && later.r == earlier.r) return true;
+
+      switch (later.kind)
+      {
+        case DRAW_FILL_RECT:
+          return _inside(earlier, later.x, later.y, later.w, later.h);
+        case DRAW_FILL_ROUND_RECT:
+          return _inside(earlier, later.x, later.y + later.r, later.w, later.h - 2 * later.r) ||
+                 _inside(earlier, later.x + later.r, later.y, later.w - 2 * later.r, later.h);
+      }
+      return false;
+    }
+
+    static bool _inside(const draw_cmd& cmd, int x, int y, int w, int h)
+    {
+      return cmd.x >= x && cmd.y >= y && cmd.x + cmd.w <= x + w && cmd.y + cmd.h <= y + h;
+    }
+
+    void _compact(void)
+    {
+      int n = 0;
+      for (int i = 0; i < _count; i++)
+      {
+        if (_cmds[i].kind != DRAW_NONE) _cmds[n++] = _cmds[i];
+      }
+      _count = n;
+    }
+
+    // add a damaged rect, merging it with every area it overlaps (they have to
+    // be drawn together to keep the order) or lines up with (same rows or
+    // columns, touching, so the union is no larger than the two)
+    void _damage(int x, int y, int w, int h)
+    {
+      int i = 0;
+      while (i < _area_count)
+      {
+        const draw_area& a = _areas[i];
+        bool overlap = x < a.x + a.w && a.x < x + w && y < a.y + a.h && a.y < y + h;
+        bool rows = y == a.y && h == a.h && x <= a.x + a.w && a.x <= x + w;
+        bool cols = x == a.x && w == a.w && y <= a.y + a.h && a.y <= y + h;
+        if (!overlap && !rows && !cols)
+        {
+          i++;
+          continue;
+        }
+
+        int x1 = (x + w > a.x + a.w) ? x + w : a.x + a.w;
+        int y1 = (y + h > a.y + a.h) ? y + h : a.y + a.h;
+        if (a.x < x) x = a.x;
+        if (a.y < y) y = a.y;
+        w = x1 - x;
+        h = y1 - y;
+
+        // the grown rect may reach areas already passed
+        _areas[i] = _areas[--_area_count];
+        i = 0;
+      }
+
+      draw_area area = {(int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h};
+      _areas[_area_count++] = area;
+    }
+
+    void _pixel(int x, int y, uint16_t color)
+    {
+      int i = (y - _clip.y) * _clip.w + (x - _clip.x);
+      _target[i] = color;
+      _painted[i / 8] |= 1 << (i % 8);
+    }
+
+    void _fill(int x, int y, int w, int h, uint16_t color)
+    {
+      int x0 = (x > _clip.x) ? x : _clip.x;
+      int y0 = (y > _clip.y) ? y : _clip.y;
+      int x1 = (x + w < _clip.x + _clip.w) ? x + w : _clip.x + _clip.w;
+      int y1 = (y + h < _clip.y + _clip.h) ? y + h : _clip.y + _clip.h;
+      for (int py = y0; py < y1; py++)
+      {
+        for (int px = x0; px < x1; px++) _pixel(px, py, color);
+      }
+    }
+
+    void _hline(int x, int y, int w, uint16_t color) { _fill(x, y, w, 1, color); }
+    void _vline(int x, int y, int h, uint16_t color) { _fill(x, y, 1, h, color); }
+
+    // TFT_eSPI fillCircleHelper: the rounded ends of fillRoundRect
+    void _corners(int x0, int y0, int r, uint8_t cornername, int delta, uint16_t color)
+    {
+      if (r <= 0) return;
+
+      int f     = 1 - r;
+      int ddF_x = 1;
+      int ddF_y = -r - r;
+      int y     = 0;
+
+      delta++;
+
+      while (y < r)
+      {
+        if (f >= 0)
+        {
+          if (cornername & 0x1) _hline(x0 - y, y0 + r, y + y + delta, color);
+          if (cornername & 0x2) _hline(x0 - y, y0 - r, y + y + delta, color);
+          r--;
+          ddF_y += 2;
+          f     += ddF_y;
+        }
+
+        y++;
+        ddF_x += 2;
+        f     += ddF_x;
+
+        if (cornername & 0x1) _hline(x0 - r, y0 + y, r + r + delta, color);
+        if (cornername & 0x2) _hline(x0 - r, y0 - y, r + r + delta, color);
+      }
+    }
+};
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * OXRS_LCD_geometry.h
+ * where the port cells of a layout are on the screen
+ *
+ * the same arithmetic the painters did per call, as functions of the layout
+ * outline (x, y, xo, bw, bh of layout_config). they are the single source of
+ * the geometry: drawPorts() runs them once into the tables of cells the
+ * painters read.
+ *
+ *   input ports    4 pins each, two rows of 8 ports per 16 ports and a 3 pixel
+ *                  gap after every 8 ports. 32, 64 and 128 wrap after 16 ports
+ *                  (the second half two rows and 3 pixels further down), 96
+ *                  runs 24 ports wide. security ports use the same cells,
+ *                  IO_48 the 96 arithmetic
+ *   output ports   1 pin each, rows of 32 with a 2 pixel gap after every 8 and
+ *                  another after 16 on MCPs of 16 outputs
+ */
+
+#ifndef OXRS_LCD_GEOMETRY_H
+#define OXRS_LCD_GEOMETRY_H
+
+#include <Arduino.h>
+
+#define     CELLS_IN                    32        // input ports
+#define     CELLS_OUT                   128       // output pins
+
+typedef struct PORT_CELL
+  {
+    int16_t x, y;
+  } port_cell;
+
+// port 0 based, wide for the 96 input layouts (and IO_48)
+constexpr int16_t inputCellX(int xo, int bw, int port, bool wide)
+{
+  return wide ? xo + (port / 8) * 3 + (port / 2) * bw
+              : xo + ((port % 16) / 8) * 3 + ((port % 16) / 2) * bw;
+}
+
+constexpr int16_t inputCellY(int y, int bh, int port, bool wide)
+{
+  return y + (port % 2) * bh + ((!wide && port > 15) ? 2 * bh + 3 : 0);
+}
+
+// index 0 based, output_pins 8 or 16 per MCP
+constexpr int16_t outputCellX(int xo, int bw, int index, int output_pins)
+{
+  return xo + ((index % 32) / 8) * 2 + ((output_pins == 16) ? ((index % 32) / 16) * 2 : 0) + (index % 32) * (bw - 1);
+}
+
+constexpr int16_t outputCellY(int y, int bh, int index)
+{
+  return y + (index / 32) * (bh + 2);
+}
+
+#endif
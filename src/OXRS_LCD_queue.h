@@ -0,0 +1,129 @@
+/*
+ * OXRS_LCD_queue.h
+ * render queue between the firmware and the render task
+ *
+ * with setRenderQueue() (or startRenderTask() on ESP32) the calls that paint
+ * only post a record here, in the order they are made, and the render side
+ * (drainRenderQueue()) applies them and does all the drawing:
+ *
+ *   firmware loop                      render task
+ *   process(mcp, io_value)   -> ring ->  _process(mcp, io_value), flush
+ *   showEvent("...")         -> ring ->  _show_event(...)
+ *   loop(), link changed     -> ring ->  _check_IP_state(), _check_MQTT_state()
+ *
+ * lcd_ring is lock-free for one producer and one consumer: each side writes
+ * only its own index, the records are published with a release store of the
+ * head and freed with one of the tail. nothing here blocks or allocates, so it
+ * runs the same under FreeRTOS and std::thread.
+ *
+ * the firmware side waits for room (and for the stats) only while the render
+ * side drains: after RENDER_QUEUE_WAIT_SPINS turns without one it gives up,
+ * and fails at once from then on until the render side drains again.
+ */
+
+#ifndef OXRS_LCD_QUEUE_H
+#define OXRS_LCD_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#define     RENDER_QUEUE_RECORDS        64        // records in flight, a power of 2
+#define     RENDER_QUEUE_EVENTS         4         // showEvent() texts in flight, a power of 2
+#define     RENDER_QUEUE_EVENT_CHARS    48        // longer events are cut
+#define     RENDER_QUEUE_LINKS          2         // link changes in flight, a power of 2
+#define     RENDER_QUEUE_TOPIC_CHARS    32        // the screen shows fewer
+#define     RENDER_QUEUE_RECORDERS      2         // startRecording()/stopRecording() in flight, a power of 2
+#define     RENDER_QUEUE_WAIT_SPINS     100000    // yield()s without a drain before a wait of the firmware side gives up
+
+// record kinds, see the public call of the same name
+#define     RECORD_PROCESS              1         // mcp, value io_value, us when seen
+#define     RECORD_MQTT_RX              2
+#define     RECORD_MQTT_TX              3
+#define     RECORD_EVENT                4         // value font, text in the event ring
+#define     RECORD_TEMP                 5         // mcp unit, value tenths of a degree (RECORD_TEMP_NAN hides)
+#define     RECORD_PIN_TYPE             6         // mcp, value pin | setting << 8
+#define     RECORD_PIN_INVERT           7
+#define     RECORD_PIN_DISABLED         8
+#define     RECORD_DIAGNOSTICS          9         // value shown
+#define     RECORD_LINK                 10        // value IP_STATE_... | MQTT_STATE_... << 8, IP, MAC and topic in the link ring
+#define     RECORD_STATS                11        // value RECORD_STATS_COPY or _RESET, waited for
+#define     RECORD_SETTING              12        // mcp SETTING_..., us the value
+#define     RECORD_RECORDING            13        // the Print (NULL stops) in the recorder ring
+
+#define     RECORD_TEMP_NAN             0x8000
+#define     RECORD_STATS_COPY           0
+#define     RECORD_STATS_RESET          1
+
+// the setters of the render side's state, see the public call
+#define     SETTING_ONTIME_DISPLAY      0
+#define     SETTING_ONTIME_EVENT        1
+#define     SETTING_BRIGHTNESS_ON       2
+#define     SETTING_BRIGHTNESS_DIM      3
+#define     SETTING_IP_POS              4
+#define     SETTING_MAC_POS             5
+#define     SETTING_MQTT_POS            6
+#define     SETTING_TEMP_POS            7
+#define     SETTING_RENDER_BUDGET       8
+
+typedef struct LCD_RECORD
+  {
+    uint8_t  kind;
+    uint8_t  mcp;
+    uint16_t value;
+    uint32_t us;
+  } lcd_record;
+
+typedef struct LCD_EVENT_TEXT
+  {
+    char text[RENDER_QUEUE_EVENT_CHARS];
+  } lcd_event_text;
+
+// what loop() read from Ethernet/WiFi and the MQTT client with the states
+typedef struct LCD_LINK
+  {
+    uint8_t ip[4];
+    uint8_t mac[6];
+    char    topic[RENDER_QUEUE_TOPIC_CHARS];
+  } lcd_link;
+
+template <typename T, uint32_t SIZE>
+class lcd_ring
+{
+  static_assert((SIZE & (SIZE - 1)) == 0, "lcd_ring needs a power of 2");
+
+  public:
+    // producer: false when full
+    bool push(const T& item)
+    {
+      uint32_t head = _head.load(std::memory_order_relaxed);
+      if (head - _tail.load(std::memory_order_acquire) == SIZE) return false;
+
+      _items[head & (SIZE - 1)] = item;
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    // producer: free slots, only ever more until the next push()
+    uint32_t space(void) const
+    {
+      return SIZE - (_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire));
+    }
+
+    // consumer: false when empty
+    bool pop(T& item)
+    {
+      uint32_t tail = _tail.load(std::memory_order_relaxed);
+      if (tail == _head.load(std::memory_order_acquire)) return false;
+
+      item = _items[tail & (SIZE - 1)];
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+  private:
+    T _items[SIZE];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+};
+
+#endif
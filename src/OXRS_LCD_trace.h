@@ -0,0 +1,73 @@
+/*
+ * OXRS_LCD_trace.h
+ * optional timeline tracing of the render paths
+ *
+ * build with OXRS_LCD_TRACE defined to get a begin and an end call to the hook
+ * set with setLcdTraceHook() around process(), loop(), the state checks, showEvent()
+ * and every TFT primitive. without OXRS_LCD_TRACE the LCD_TRACE_... macros expand
+ * to nothing and tft is a plain TFT_eSPI.
+ */
+
+#ifndef OXRS_LCD_TRACE_H
+#define OXRS_LCD_TRACE_H
+
+#ifdef OXRS_LCD_TRACE
+
+#include <TFT_eSPI.h>
+
+// name is a string literal, begin is false for the matching end
+typedef void (*lcd_trace_hook)(const char * name, bool begin);
+
+void setLcdTraceHook(lcd_trace_hook hook);
+
+extern lcd_trace_hook _lcd_trace_hook;
+
+class lcd_trace_scope
+{
+  public:
+    lcd_trace_scope(const char * name) : _name(name)
+    {
+      if (_lcd_trace_hook) _lcd_trace_hook(_name, true);
+    }
+    ~lcd_trace_scope()
+    {
+      if (_lcd_trace_hook) _lcd_trace_hook(_name, false);
+    }
+
+  private:
+    const char * _name;
+};
+
+#define LCD_TRACE_SCOPE(name)         lcd_trace_scope _lcd_trace_scope(name)
+
+// TFT_eSPI with every primitive OXRS_LCD draws with wrapped in a trace scope
+#define LCD_TRACE_TFT(primitive) \
+    template <typename... Args> \
+    auto primitive(Args... args) -> decltype(TFT_eSPI::primitive(args...)) \
+    { \
+      LCD_TRACE_SCOPE(#primitive); \
+      return TFT_eSPI::primitive(args...); \
+    }
+
+class lcd_trace_tft : public TFT_eSPI
+{
+  public:
+    LCD_TRACE_TFT(fillRect)
+    LCD_TRACE_TFT(drawRect)
+    LCD_TRACE_TFT(fillRoundRect)
+    LCD_TRACE_TFT(drawString)
+    LCD_TRACE_TFT(pushImage)
+    LCD_TRACE_TFT(setAddrWindow)
+    LCD_TRACE_TFT(pushPixels)
+    LCD_TRACE_TFT(drawBitmap)
+};
+
+#undef LCD_TRACE_TFT
+
+#else
+
+#define LCD_TRACE_SCOPE(name)
+
+#endif
+
+#endif
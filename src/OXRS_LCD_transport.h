@@ -0,0 +1,70 @@
+/*
+ * OXRS_LCD_transport.h
+ * how the rendered pixels get to the display
+ *
+ * the port areas (see _push_area), the shadow tiles and the logo rows are
+ * rendered into a buffer and pushed into an address window. by default that
+ * is TFT_eSPI setAddrWindow() and pushPixels(), which return once the pixels
+ * are sent. setTransport() hands them to a transport instead, which may send
+ * them in the background while the next block is rendered into a second
+ * buffer:
+ *
+ *   render A, push A | render B, push B (waits for A) | render A, ...
+ *
+ * a transport is only used inside the SPI transaction of a write_scope, and
+ * it is waited for before any other primitive is drawn and before the
+ * transaction ends. so process() and loop() may return once their last block
+ * is sent, not before: the other primitives and the W5500 of the RACK32 share
+ * the bus.
+ *
+ *   tft_dma_transport   ESP32 DMA of TFT_eSPI (pushPixelsDMA), only for a
+ *                       display that has its SPI bus to itself
+ */
+
+#ifndef OXRS_LCD_TRANSPORT_H
+#define OXRS_LCD_TRANSPORT_H
+
+#include <TFT_eSPI.h>
+
+class lcd_transport
+{
+  public:
+    virtual ~lcd_transport() {}
+
+    // the pixels pushed from here on fill x, y, w, h row by row, on the display
+    virtual void window(int16_t x, int16_t y, int16_t w, int16_t h) = 0;
+
+    // len pixels, byte order as with setSwapBytes(true). may return while they
+    // are sent and may swap them in place, but waits for the push before, so
+    // the buffer of that one can be written again once this returns
+    virtual void push(uint16_t * pixels, uint32_t len) = 0;
+
+    // until every push is on the display, then all buffers can be written
+    virtual void wait(void) = 0;
+};
+
+#if defined(ESP32)
+// pushes by DMA, one in flight (TFT_eSPI waits for it before the next)
+class tft_dma_transport : public lcd_transport
+{
+  public:
+    tft_dma_transport(TFT_eSPI& tft) : _tft(tft) {}
+
+    // after OXRS_LCD::begin(), false when the DMA channel cannot be set up
+    bool begin(void) { return _tft.initDMA(); }
+
+    void window(int16_t x, int16_t y, int16_t w, int16_t h)
+    {
+      _tft.dmaWait();
+      _tft.setAddrWindow(x, y, w, h);
+    }
+
+    void push(uint16_t * pixels, uint32_t len) { _tft.pushPixelsDMA(pixels, len); }
+    void wait(void) { _tft.dmaWait(); }
+
+  private:
+    TFT_eSPI& _tft;
+};
+#endif
+
+#endif
@@ -0,0 +1,245 @@
+/*
+ * bench.cpp
+ * microbenchmarks for the OXRS_LCD hot paths
+ *
+ *   process()      no change, one pin changed, all 16 pins changed and the repaint
+ *                  of an MCP after a pin config call, per PORT_LAYOUT_...
+ *                  (followed by the loop() that draws the changes)
+ *   drawPorts()    per PORT_LAYOUT_...
+ *   loop()         idle
+ *   _drawBmp_P()   the embedded OXRS logo
+ *
+ * every case is timed on the host CPU (best of several runs, ns/op) and
+ * counted once with recording on (TFT primitives and SPI bytes per op).
+ *
+ *   bench [-f filter] [-s shadow] [-o results] [-b baseline] [-t tolerance_pct]
+ *
+ *   -f   only run cases whose name contains filter
+ *   -s   boot with setShadowBuffer(shadow), 1 SHADOW_RGB565, 2 SHADOW_PALETTE
+ *   -o   write "name ns/op draws/op" lines to results
+ *   -b   compare with a results file written by -o, exit 1 when a case got
+ *        slower than tolerance (default 15 %) or draws more primitives
+ */
+
+#include "host_rig.h"
+#include "bench_access.h"
+#include "spi_cost.h"
+
+#include <chrono>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// the embedded logo, wrapped so its non-static length does not clash with the library
+namespace bench_logo {
+#include <OXRS_logo.h>
+}
+
+#define     BENCH_RUNS                  5
+#define     BENCH_MIN_NS                5000000   // calibrate each run to at least 5 ms
+#define     BENCH_COUNT_OPS             16        // ops recorded to count primitives
+
+struct bench_result
+{
+  std::string name;
+  double      ns_per_op;
+  double      draws_per_op;
+  double      bytes_per_op;
+};
+
+static std::vector<bench_result> results;
+static const char * filter = NULL;
+static int shadow = SHADOW_OFF;
+
+static double elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename F>
+static void bench(host_rig& rig, const std::string& name, F op)
+{
+  if (filter && name.find(filter) == std::string::npos) return;
+
+  TFT_eSPI * tft = rig.tft();
+
+  // count primitives and bus bytes
+  tft->hostRecord(true);
+  tft->hostClearOps();
+  tft_bus_stats before = tft->hostBusStats();
+  for (int i = 0; i < BENCH_COUNT_OPS; i++) op();
+  tft_bus_stats bus = tftBusDelta(tft->hostBusStats(), before);
+  double draws = (double)tft->hostOps().size() / BENCH_COUNT_OPS;
+  tft->hostClearOps();
+  tft->hostRecord(false);
+
+  // calibrate, then keep the best of a few runs
+  long iters = 1;
+  for (;;)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iters; i++) op();
+    if (elapsed_ns(start) >= BENCH_MIN_NS) break;
+    iters *= 2;
+  }
+
+  double best = 0;
+  for (int run = 0; run < BENCH_RUNS; run++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iters; i++) op();
+    double ns = elapsed_ns(start) / iters;
+    if (run == 0 || ns < best) best = ns;
+  }
+
+  bench_result result = {name, best, draws, (double)spiBusBytes(bus) / BENCH_COUNT_OPS};
+  results.push_back(result);
+  printf("%-40s %12.1f ns/op %9.1f draws/op %11.0f bytes/op\n",
+    name.c_str(), result.ns_per_op, result.draws_per_op, result.bytes_per_op);
+  fflush(stdout);
+}
+
+static void bench_layout(const host_layout& layout)
+{
+  host_rig rig;
+  rig.tft()->hostRecord(false);
+  rig.boot(layout.port_layout, 0xff, shadow);
+
+  uint16_t io_value = 0xffff;
+  std::string suffix = std::string(" ") + layout.name;
+
+  bench(rig, "process() no change" + suffix, [&] {
+    rig.lcd.process(0, io_value);
+    rig.lcd.loop();
+  });
+  bench(rig, "process() 1 pin" + suffix, [&] {
+    io_value ^= 0x0001;
+    rig.lcd.process(0, io_value);
+    rig.lcd.loop();
+  });
+  bench(rig, "process() 16 pins" + suffix, [&] {
+    io_value ^= 0xffff;
+    rig.lcd.process(0, io_value);
+    rig.lcd.loop();
+  });
+  bench(rig, "process() after config" + suffix, [&] {
+    rig.lcd.setPinInvert(0, 0, 0);
+    rig.lcd.process(0, io_value);
+    rig.lcd.loop();
+  });
+  bench(rig, "drawPorts()" + suffix, [&] {
+    rig.lcd.drawPorts(layout.port_layout, 0xff);
+  });
+}
+
+static bool load_baseline(const char * path, std::map<std::string, std::pair<double, double>>& baseline)
+{
+  FILE * f = fopen(path, "r");
+  if (!f) return false;
+
+  char line[256];
+  while (fgets(line, sizeof(line), f))
+  {
+    // name ns draws, the name may contain spaces
+    char * draws = strrchr(line, ' ');
+    if (!draws) continue;
+    *draws++ = 0;
+    char * ns = strrchr(line, ' ');
+    if (!ns) continue;
+    *ns++ = 0;
+    baseline[line] = std::make_pair(atof(ns), atof(draws));
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char ** argv)
+{
+  const char * out_path = NULL;
+  const char * baseline_path = NULL;
+  double tolerance = 15.0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:s:o:b:t:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'f': filter = optarg; break;
+      case 's': shadow = atoi(optarg); break;
+      case 'o': out_path = optarg; break;
+      case 'b': baseline_path = optarg; break;
+      case 't': tolerance = atof(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-f filter] [-s shadow] [-o results] [-b baseline] [-t tolerance_pct]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  for (size_t i = 0; i < HOST_LAYOUT_COUNT; i++)
+  {
+    bench_layout(host_layouts[i]);
+  }
+
+  {
+    host_rig rig;
+    rig.tft()->hostRecord(false);
+    rig.boot(PORT_LAYOUT_INPUT_128, 0xff, shadow);
+
+    bench(rig, "loop() idle", [&] {
+      rig.lcd.loop();
+    });
+    bench(rig, "_drawBmp_P() OXRS_logo", [&] {
+      bench_access::drawBmp_P(rig.lcd, bench_logo::OXRS_logo, 0, 0, 40, 40);
+    });
+  }
+
+  if (out_path)
+  {
+    FILE * f = fopen(out_path, "w");
+    if (!f)
+    {
+      perror(out_path);
+      return 1;
+    }
+    for (const bench_result& result : results)
+    {
+      fprintf(f, "%s %.1f %.1f\n", result.name.c_str(), result.ns_per_op, result.draws_per_op);
+    }
+    fclose(f);
+  }
+
+  if (baseline_path)
+  {
+    std::map<std::string, std::pair<double, double>> baseline;
+    if (!load_baseline(baseline_path, baseline))
+    {
+      perror(baseline_path);
+      return 1;
+    }
+
+    int regressions = 0;
+    for (const bench_result& result : results)
+    {
+      auto it = baseline.find(result.name);
+      if (it == baseline.end()) continue;
+
+      double base_ns = it->second.first;
+      double base_draws = it->second.second;
+      bool slower = result.ns_per_op > base_ns * (1.0 + tolerance / 100.0);
+      bool more_draws = result.draws_per_op > base_draws + 0.05;
+      if (slower || more_draws)
+      {
+        printf("REGRESSION %-40s %10.1f -> %10.1f ns/op %7.1f -> %7.1f draws/op\n",
+          result.name.c_str(), base_ns, result.ns_per_op, base_draws, result.draws_per_op);
+        regressions++;
+      }
+    }
+    printf("%d regression(s) against %s\n", regressions, baseline_path);
+    return regressions ? 1 : 0;
+  }
+
+  return 0;
+}
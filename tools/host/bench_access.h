@@ -0,0 +1,21 @@
+/*
+ * bench_access.h
+ * access to OXRS_LCD privates for the benchmarks that time a single painter
+ *
+ * a friend of OXRS_LCD in the host build (OXRS_LCD_HOST, set by the Makefile)
+ */
+
+#ifndef BENCH_ACCESS_H
+#define BENCH_ACCESS_H
+
+#include <OXRS_LCD.h>
+
+struct bench_access
+{
+  static bool drawBmp_P(OXRS_LCD& lcd, const uint8_t * image, int16_t x, int16_t y, int16_t w, int16_t h)
+  {
+    return lcd._drawBmp_P(image, x, y, w, h);
+  }
+};
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * chrome_trace.cpp
+ * writes the OXRS_LCD trace hooks as Chrome trace-event JSON
+ *
+ */
+
+#include "chrome_trace.h"
+
+#include <OXRS_LCD_trace.h>
+
+#include <algorithm>
+#include <chrono>
+
+static FILE *               trace_file = NULL;
+static TFT_eSPI *           trace_tft = NULL;
+static spi_timing           trace_timing;
+static chrome_trace_clock   trace_clock;
+static size_t               trace_events = 0;
+
+static std::chrono::steady_clock::time_point trace_start;
+
+// device clock: never behind the virtual clock, moved on by the bus time since the last event
+static double last_ts = 0;
+static double last_bus_us = 0;
+
+static double timestamp(void)
+{
+  if (trace_clock == CHROME_TRACE_HOST)
+  {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - trace_start).count();
+  }
+
+  double bus_us = spiBusMicros(trace_tft->hostBusStats(), trace_timing);
+  last_ts = std::max(last_ts, (double)hostClockMicros()) + (bus_us - last_bus_us);
+  last_bus_us = bus_us;
+  return last_ts;
+}
+
+static void trace_hook(const char * name, bool begin)
+{
+  double ts = timestamp();
+  fprintf(trace_file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":1}",
+    trace_events ? "," : "", name, begin ? 'B' : 'E', ts);
+  trace_events++;
+}
+
+bool chromeTraceOpen(const char * path, TFT_eSPI * tft, const spi_timing& timing, chrome_trace_clock clock)
+{
+  trace_file = fopen(path, "w");
+  if (!trace_file) return false;
+
+  trace_tft = tft;
+  trace_timing = timing;
+  trace_clock = clock;
+  trace_events = 0;
+  trace_start = std::chrono::steady_clock::now();
+  last_ts = 0;
+  last_bus_us = spiBusMicros(tft->hostBusStats(), timing);
+
+  fprintf(trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  fprintf(trace_file, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"OXRS_LCD\"}}");
+  trace_events++;
+
+  setLcdTraceHook(trace_hook);
+  return true;
+}
+
+void chromeTraceClose(void)
+{
+  setLcdTraceHook(NULL);
+  if (!trace_file) return;
+
+  fprintf(trace_file, "\n]}\n");
+  fclose(trace_file);
+  trace_file = NULL;
+}
+
+size_t chromeTraceEvents(void)
+{
+  return trace_events;
+}
@@ -0,0 +1,31 @@
+/*
+ * chrome_trace.h
+ * writes the OXRS_LCD trace hooks as Chrome trace-event JSON
+ *
+ * needs the library built with OXRS_LCD_TRACE. load the file in
+ * chrome://tracing or https://ui.perfetto.dev
+ *
+ * timestamps follow one of two clocks:
+ *   CHROME_TRACE_DEVICE   virtual clock plus the SPI bus time of the primitives,
+ *                         i.e. how long the calls would take on the board
+ *   CHROME_TRACE_HOST     host CPU time since chromeTraceOpen()
+ */
+
+#ifndef CHROME_TRACE_H
+#define CHROME_TRACE_H
+
+#include "spi_cost.h"
+
+enum chrome_trace_clock
+{
+  CHROME_TRACE_DEVICE,
+  CHROME_TRACE_HOST,
+};
+
+bool chromeTraceOpen(const char * path, TFT_eSPI * tft, const spi_timing& timing, chrome_trace_clock clock);
+void chromeTraceClose(void);
+
+// events written so far
+size_t chromeTraceEvents(void);
+
+#endif
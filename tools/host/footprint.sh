@@ -0,0 +1,121 @@
+#!/bin/sh
+#
+# footprint.sh
+# flash/RAM footprint of OXRS_LCD per feature
+#
+# compiles src/OXRS_LCD.cpp with -Os once per compile-time opt-out (see
+# OXRS_LCD.h), once with all of them and once with the timeline trace, and
+# reports text/data/bss, sizeof(OXRS_LCD), the saving against the full build
+# and the TFT_eSPI free fonts each build references. then breaks the full
+# build (and the trace) down by feature from its symbol sizes.
+#
+# the sizes are for the host compiler, not xtensa, so read them as relative
+#
+#   footprint.sh [build_dir]
+#
+
+set -e
+
+CXX=${CXX:-g++}
+BUILD=${1:-build}/footprint
+ROOT=$(dirname "$0")/../..
+FLAGS="-std=gnu++11 -Os -ffunction-sections -fdata-sections -Wno-comment -I$(dirname "$0")/stubs -I$ROOT/src -I$ROOT/UserSetup"
+
+mkdir -p "$BUILD"
+
+# sizeof(OXRS_LCD), the RAM of the object before anything is turned on
+cat > "$BUILD/sizeof.cpp" <<'EOF'
+#include <OXRS_LCD.h>
+#include <stdio.h>
+int main(void) { printf("%zu\n", sizeof(OXRS_LCD)); return 0; }
+EOF
+
+# text data bss of an object, only counting sections the linker would keep
+sizes()
+{
+  size -A "$1" | awk '
+    $1 ~ /^\.text|^\.rodata/  { text += $2 }
+    $1 ~ /^\.data/            { data += $2 }
+    $1 ~ /^\.bss/             { bss += $2 }
+    END                       { print text + 0, data + 0, bss + 0 }'
+}
+
+fonts()
+{
+  nm -u "$1" | awk '/9pt7b/ { printf "%s%s", sep, $2; sep = " " } END { print "" }'
+}
+
+ALL="-DOXRS_LCD_NO_BMP_FILE -DOXRS_LCD_NO_WIFI -DOXRS_LCD_NO_IO_48 -DOXRS_LCD_NO_FONT_PROP -DOXRS_LCD_NO_RENDER_STATS"
+
+printf "%-28s %8s %6s %6s %8s %8s  %s\n" "build" "text" "data" "bss" "sizeof" "saved" "free fonts"
+
+full_text=
+for variant in full NO_BMP_FILE NO_ETHERNET NO_WIFI NO_IO_48 NO_FONT_MONO NO_FONT_PROP NO_LED_TILES NO_RENDER_STATS all TRACE; do
+  case $variant in
+    full)  defines= ;;
+    all)   defines=$ALL; variant="all but ethernet" ;;
+    TRACE) defines=-DOXRS_LCD_TRACE; variant="with TRACE" ;;
+    *)     defines=-DOXRS_LCD_$variant ;;
+  esac
+
+  object="$BUILD/$(echo "$variant" | tr ' ' '_').o"
+  $CXX $FLAGS $defines -c "$ROOT/src/OXRS_LCD.cpp" -o "$object"
+  $CXX $FLAGS $defines "$BUILD/sizeof.cpp" -o "$BUILD/sizeof"
+
+  set -- $(sizes "$object")
+  [ -z "$full_text" ] && full_text=$(($1 + $2))
+  printf "%-28s %8d %6d %6d %8d %8d  %s\n" "$variant" "$1" "$2" "$3" "$("$BUILD/sizeof")" $((full_text - $1 - $2)) "$(fonts "$object")"
+done
+
+# symbol sizes of an object summed by feature
+features()
+{
+  nm -S -C -t d --size-sort "$1" | awk '
+  NF < 4 { next }
+  {
+    size = $2 + 0
+    name = $0
+    sub(/^[^ ]+ [^ ]+ [^ ]+ /, "", name)
+
+    # the complete and base object constructors are one function
+    if (seen[name]++) next
+
+    feature = "other"
+    if      (name ~ /lcd_trace|LcdTrace/)                            feature = "timeline trace"
+    else if (name ~ /OXRS_LCD::OXRS_LCD|OXRS_LCD::~OXRS_LCD/)       feature = "constructors"
+    else if (name ~ /std::|TFT_eSPI::|^tft$/)                        feature = "TFT_eSPI object and host stand-ins"
+    else if (name ~ /OXRS_logo/)                                     feature = "embedded OXRS logo"
+    else if (name ~ /^Roboto/)                                       feature = "Roboto fonts"
+    else if (name ~ /icon_/)                                         feature = "icons"
+    else if (name ~ /_drawBmp\(|::_read(16|32)\(/)                   feature = "BMP from LittleFS"
+    else if (name ~ /_drawBmp_P|_read(16|32)_P/)                     feature = "BMP from PROGMEM"
+    else if (name ~ /_update_io_48/)                                 feature = "IO_48 painter"
+    else if (name ~ /_update_(input|output|security)|_security_shade|_drawn_/) feature = "port painters"
+    else if (name ~ /LedTiles/)                                      feature = "LED tiles"
+    else if (name ~ /[Ss]hadow|_palette/)                            feature = "shadow buffer"
+    else if (name ~ /[Tt]ransport|_push_(window|pixels|buffer|bmp_row)/) feature = "transport"
+    else if (name ~ /draw_list|_draw\(|_draw_cmd|_flush_draws|_push_area|_clip|_band|::_render\(|draw_buffer_alloc|_write_(open|end)/) feature = "draw list and flush"
+    else if (name ~ /_schedule|_over_budget|_set_budget|RenderBudget|[Pp]ending_?[Rr]epaints/) feature = "render budget scheduler"
+    else if (name ~ /lcd_ring|_apply|_post|_queue_process|_request_stats|_render_(waiting|wake|shown|task)|RenderQueue|RenderTask|_setting/) feature = "render queue"
+    else if (name ~ /[Dd]iag/)                                       feature = "diagnostics page"
+    else if (name ~ /[Pp]in_?([Tt]ype|[Ii]nvert|[Dd]isabled)/)       feature = "pin config"
+    else if (name ~ /drawPorts|process|_check_port_flash|_getPortLayoutGroup|_ports_|_build_.*_cells|_pin_/) feature = "port layouts"
+    else if (name ~ /IP|MAC|MQTT|[Mm]qtt|_ip_/)                      feature = "network and MQTT info"
+    else if (name ~ /Recording|_record/)                             feature = "io trace recording"
+    else if (name ~ /RenderStats|[Ll]atency|render_stat/)            feature = "render statistics"
+    else if (name ~ /[Hh]eader|_draw_logo|showEvent|_show_event|_clear_event|[Tt]emp|_draw_slices|[Ss]creen_?[Dd]rawn/) feature = "header and events"
+
+    total[feature] += size
+  }
+  END {
+    for (feature in total) printf "%8d  %s\n", total[feature], feature
+  }' | sort -rn
+}
+
+echo
+echo "full build by feature"
+features "$BUILD/full.o"
+
+echo
+echo "with TRACE, besides the scopes inlined into the traced calls"
+features "$BUILD/with_TRACE.o" | grep "timeline trace" || true
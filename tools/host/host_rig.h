@@ -0,0 +1,151 @@
+/*
+ * host_rig.h
+ * an OXRS_LCD wired to stand-in Ethernet and MQTT, shared by the host tools
+ *
+ */
+
+#ifndef HOST_RIG_H
+#define HOST_RIG_H
+
+#include <OXRS_LCD.h>
+
+#include <atomic>
+#include <thread>
+
+// every PORT_LAYOUT_... value, in the order of OXRS_LCD.h
+struct host_layout
+{
+  int          port_layout;
+  const char * name;
+};
+
+static const host_layout host_layouts[] =
+{
+  {PORT_LAYOUT_INPUT_AUTO,      "INPUT_AUTO"},
+  {PORT_LAYOUT_INPUT_32,        "INPUT_32"},
+  {PORT_LAYOUT_INPUT_64,        "INPUT_64"},
+  {PORT_LAYOUT_INPUT_96,        "INPUT_96"},
+  {PORT_LAYOUT_INPUT_128,       "INPUT_128"},
+  {PORT_LAYOUT_OUTPUT_AUTO,     "OUTPUT_AUTO"},
+  {PORT_LAYOUT_OUTPUT_32,       "OUTPUT_32"},
+  {PORT_LAYOUT_OUTPUT_64,       "OUTPUT_64"},
+  {PORT_LAYOUT_OUTPUT_96,       "OUTPUT_96"},
+  {PORT_LAYOUT_OUTPUT_128,      "OUTPUT_128"},
+  {PORT_LAYOUT_OUTPUT_AUTO_8,   "OUTPUT_AUTO_8"},
+  {PORT_LAYOUT_OUTPUT_32_8,     "OUTPUT_32_8"},
+  {PORT_LAYOUT_OUTPUT_64_8,     "OUTPUT_64_8"},
+  {PORT_LAYOUT_IO_48,           "IO_48"},
+  {PORT_LAYOUT_IO_32_96,        "IO_32_96"},
+  {PORT_LAYOUT_IO_64_64,        "IO_64_64"},
+  {PORT_LAYOUT_IO_96_32,        "IO_96_32"},
+  {PORT_LAYOUT_IO_32_96_8,      "IO_32_96_8"},
+  {PORT_LAYOUT_IO_64_64_8,      "IO_64_64_8"},
+  {PORT_LAYOUT_IO_96_32_8,      "IO_96_32_8"},
+};
+
+#define HOST_LAYOUT_COUNT (sizeof(host_layouts) / sizeof(host_layouts[0]))
+
+// the render side of setRenderQueue() on a thread of its own, as the render
+// task of startRenderTask() on the second core
+class host_render_thread
+{
+  public:
+    ~host_render_thread() { stop(); }
+
+    // the queue on, drainRenderQueue() over and over until stop()
+    void start(OXRS_LCD& lcd)
+    {
+      _lcd = &lcd;
+      _lcd->setRenderQueue(true);
+      _stop = false;
+      _thread = std::thread([this]()
+      {
+        while (!_stop)
+        {
+          _lcd->drainRenderQueue();
+          std::this_thread::yield();
+        }
+      });
+    }
+
+    // the thread joined and what is left drained on this one, the io_values
+    // that found the queue full posted by one more loop() first
+    void stop(void)
+    {
+      if (!_lcd) return;
+      if (_thread.joinable())
+      {
+        _stop = true;
+        _thread.join();
+      }
+      _lcd->drainRenderQueue();
+      _lcd->loop();
+      _lcd->drainRenderQueue();
+    }
+
+  private:
+    OXRS_LCD *        _lcd = NULL;
+    std::thread       _thread;
+    std::atomic<bool> _stop{false};
+};
+
+struct host_rig
+{
+  EthernetClass ethernet;
+  OXRS_MQTT     mqtt;
+  OXRS_LCD      lcd;
+  host_render_thread render;
+  int           sliced_loops = 0;
+
+  host_rig() : lcd(ethernet, mqtt) {}
+
+  TFT_eSPI * tft(void) { return lcd.getTft(); }
+
+  // link up with an IP address and MQTT connected
+  void linkUp(void)
+  {
+    ethernet.hostSetLink(LinkON);
+    ethernet.hostSetIP(IPAddress(192, 168, 1, 42));
+    mqtt.hostSetConnected(true);
+  }
+
+  // screen as it looks once the firmware is up: header, ports, link and
+  // every MCP found reporting all inputs high (inactive), drawn by loop().
+  // the LED tiles and the transport (if any) are set before anything is
+  // drawn. queued leaves the rest to a render thread from drawPorts() on,
+  // until render.stop(). sliced
+  // has loop() draw the header and ports (startDrawHeader/Ports), the MCPs
+  // report while it does, sliced_loops counts the loop() calls it took
+  void boot(int port_layout, uint8_t mcps_found, int shadow = SHADOW_OFF, lcd_transport * transport = NULL, bool queued = false, bool sliced = false)
+  {
+    lcd.begin();
+    lcd.setLedTiles(true);
+    lcd.setShadowBuffer(shadow);
+    lcd.setTransport(transport);
+    if (sliced)
+    {
+      lcd.startDrawHeader("host", "OXRS", "0.0.0", "linux");
+      lcd.startDrawPorts(port_layout, mcps_found);
+    }
+    else
+    {
+      lcd.drawHeader("host", "OXRS", "0.0.0", "linux");
+      lcd.drawPorts(port_layout, mcps_found);
+    }
+    if (queued) render.start(lcd);
+    linkUp();
+    lcd.loop();
+    for (int mcp = 0; mcp < 8; mcp++)
+    {
+      lcd.process(mcp, 0xffff);
+    }
+    lcd.loop();
+
+    for (sliced_loops = 2; !lcd.screenDrawn(); sliced_loops++)
+    {
+      lcd.loop();
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * host_transport.h
+ * a DMA transport stand-in (see src/OXRS_LCD_transport.h) that checks how
+ * OXRS_LCD uses it
+ *
+ * one push is in flight at a time, as with TFT_eSPI pushPixelsDMA(): it swaps
+ * the pixels in place when setSwapBytes(true) is set and they reach the
+ * framebuffer when the next push(), window() or wait() comes. checked:
+ *
+ *   - a buffer is not written while its push is in flight
+ *   - every window gets exactly its pixels, none are pushed outside one
+ *   - hostInFlight() is false once process(), loop() or drawHeader() return
+ *     (up to the caller)
+ *
+ * hostOverlapped() counts the pushes that found the one before still in
+ * flight from the other buffer, i.e. the blocks rendered while one was sent
+ */
+
+#ifndef HOST_TRANSPORT_H
+#define HOST_TRANSPORT_H
+
+#include <OXRS_LCD_transport.h>
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+class host_transport : public lcd_transport
+{
+  public:
+    host_transport(TFT_eSPI& tft) : _tft(tft) {}
+
+    void window(int16_t x, int16_t y, int16_t w, int16_t h)
+    {
+      _complete();
+      if (_window_left) _fail("window of %u pixels left unfilled", _window_left);
+
+      _tft.setAddrWindow(x, y, w, h);
+      _window_left = (uint32_t)w * h;
+    }
+
+    void push(uint16_t * pixels, uint32_t len)
+    {
+      if (_in_flight && _in_flight != pixels) _overlapped++;
+      _complete();
+      if (len > _window_left) _fail("push of %u pixels into a window with %u left", len, _window_left);
+      _window_left -= (len > _window_left) ? _window_left : len;
+      _pushes++;
+
+      if (_tft.getSwapBytes())
+      {
+        for (uint32_t i = 0; i < len; i++) pixels[i] = (pixels[i] >> 8) | (pixels[i] << 8);
+      }
+      _sent.assign(pixels, pixels + len);
+      _in_flight = pixels;
+    }
+
+    void wait(void) { _complete(); }
+
+    bool     hostInFlight(void) const { return _in_flight != NULL; }
+    int      hostFailures(void) const { return _failures; }
+    const std::string& hostFirstFailure(void) const { return _first_failure; }
+    uint32_t hostPushes(void) const { return _pushes; }
+    uint32_t hostOverlapped(void) const { return _overlapped; }
+
+  private:
+    TFT_eSPI&             _tft;
+    uint16_t *            _in_flight = NULL;
+    std::vector<uint16_t> _sent;
+    uint32_t              _window_left = 0;
+    uint32_t              _pushes = 0;
+    uint32_t              _overlapped = 0;
+    int                   _failures = 0;
+    std::string           _first_failure;
+
+    // the push in flight is on the display, its buffer may be written again
+    void _complete(void)
+    {
+      if (!_in_flight) return;
+      if (memcmp(_in_flight, _sent.data(), _sent.size() * sizeof(uint16_t)) != 0)
+      {
+        _fail("buffer written while its push of %zu pixels was in flight", _sent.size());
+      }
+
+      // already swapped
+      bool swap = _tft.getSwapBytes();
+      _tft.setSwapBytes(false);
+      _tft.pushPixels(_sent.data(), _sent.size());
+      _tft.setSwapBytes(swap);
+      _in_flight = NULL;
+    }
+
+    template <typename... ARGS>
+    void _fail(const char * format, ARGS... args)
+    {
+      char message[128];
+      snprintf(message, sizeof(message), format, args...);
+      if (!_failures++) _first_failure = message;
+    }
+};
+
+#endif
@@ -0,0 +1,200 @@
+/*
+ * io_record.cpp
+ * writes a synthetic io trace through OXRS_LCD::startRecording()
+ *
+ * stands in for a capture from an installation: polls every MCP found the way
+ * the firmware does, with occasional single pin changes on the plain inputs
+ * and a zone trip now and then on the security MCPs, where several ports go to
+ * ALARM (one TAMPER) within a few ms and return to NORMAL a while later
+ *
+ *   io_record [-l port_layout] [-m mcps_found] [-S security_mcps] [-s seconds]
+ *             [-p poll_ms] [-i input_ms] [-z trip_ms] [-b ports] [-r seed] trace
+ *
+ *   -l   PORT_LAYOUT_... value (default 1128, PORT_LAYOUT_INPUT_128)
+ *   -m   bitmask of MCPs found (default 0xff)
+ *   -S   bitmask of MCPs wired to security sensors (default 0x0f)
+ *   -s   length of the recording in seconds (default 60)
+ *   -p   poll interval in ms (default 5)
+ *   -i   mean time between input changes in ms (default 400)
+ *   -z   mean time between zone trips in ms (default 10000)
+ *   -b   ports tripped per zone trip (default 6)
+ *   -r   random seed (default 1)
+ */
+
+#include "host_rig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+// security port states, one nibble per port
+#define     SECURITY_NORMAL             0x5
+#define     SECURITY_ALARM              0x1
+#define     SECURITY_TAMPER             0x2
+
+#define     TRIP_RESTORE_MS             2000      // tripped ports return to NORMAL after
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+// true on average once every mean_ms
+static bool chance(int poll_ms, int mean_ms)
+{
+  return mean_ms > 0 && (int)(rng() % mean_ms) < poll_ms;
+}
+
+struct port_change
+{
+  uint32_t ms;
+  uint8_t  port;
+  uint8_t  state;
+};
+
+static void set_port(uint16_t * io_values, int port, int state)
+{
+  int shift = (port % 4) * 4;
+  io_values[port / 4] = (io_values[port / 4] & ~(0x0f << shift)) | (state << shift);
+}
+
+int main(int argc, char ** argv)
+{
+  int port_layout = PORT_LAYOUT_INPUT_128;
+  int mcps_found = 0xff;
+  int security_mcps = 0x0f;
+  int seconds = 60;
+  int poll_ms = 5;
+  int input_ms = 400;
+  int trip_ms = 10000;
+  int trip_ports = 6;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "l:m:S:s:p:i:z:b:r:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'l': port_layout = strtol(optarg, NULL, 0); break;
+      case 'm': mcps_found = strtol(optarg, NULL, 0); break;
+      case 'S': security_mcps = strtol(optarg, NULL, 0); break;
+      case 's': seconds = atoi(optarg); break;
+      case 'p': poll_ms = atoi(optarg); break;
+      case 'i': input_ms = atoi(optarg); break;
+      case 'z': trip_ms = atoi(optarg); break;
+      case 'b': trip_ports = atoi(optarg); break;
+      case 'r': rng_state = strtoul(optarg, NULL, 0) | 1; break;
+      default:
+        optind = argc + 1;
+    }
+  }
+  if (optind != argc - 1 || poll_ms < 1)
+  {
+    fprintf(stderr, "usage: %s [-l port_layout] [-m mcps_found] [-S security_mcps] [-s seconds] [-p poll_ms] [-i input_ms] [-z trip_ms] [-b ports] [-r seed] trace\n", argv[0]);
+    return 1;
+  }
+
+  security_mcps &= mcps_found;
+
+  std::vector<int> input_mcps, security_ports;
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    if (!bitRead(mcps_found, mcp)) continue;
+    if (bitRead(security_mcps, mcp))
+    {
+      for (int port = mcp * 4; port < mcp * 4 + 4; port++) security_ports.push_back(port);
+    }
+    else
+    {
+      input_mcps.push_back(mcp);
+    }
+  }
+
+  host_rig rig;
+  rig.tft()->hostRecord(false);
+  rig.boot(port_layout, mcps_found);
+
+  uint16_t io_values[8];
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    if (bitRead(security_mcps, mcp))
+    {
+      for (int pin = 0; pin < 16; pin++) rig.lcd.setPinType(mcp, pin, PIN_TYPE_SECURITY);
+      io_values[mcp] = 0x1111 * SECURITY_NORMAL;
+    }
+    else
+    {
+      io_values[mcp] = 0xffff;
+    }
+  }
+
+  File trace(fopen(argv[optind], "wb"));
+  if (!trace)
+  {
+    perror(argv[optind]);
+    return 1;
+  }
+  rig.lcd.startRecording(&trace);
+
+  std::vector<port_change> pending;
+  uint32_t start = millis();
+  int trips = 0, inputs = 0;
+
+  while (millis() - start < (uint32_t)seconds * 1000)
+  {
+    uint32_t now = millis();
+
+    // zone trip: a burst of ports to ALARM, spread over a few ms, restored later
+    if (!security_ports.empty() && chance(poll_ms, trip_ms))
+    {
+      uint32_t at = now;
+      for (int i = 0; i < trip_ports; i++)
+      {
+        int port = security_ports[rng() % security_ports.size()];
+        int state = (i == trip_ports - 1) ? SECURITY_TAMPER : SECURITY_ALARM;
+        at += rng() % 4;
+        pending.push_back({at, (uint8_t)port, (uint8_t)state});
+        pending.push_back({at + TRIP_RESTORE_MS, (uint8_t)port, SECURITY_NORMAL});
+      }
+      trips++;
+    }
+
+    // plain inputs: a button press or a contact opening
+    if (!input_mcps.empty() && chance(poll_ms, input_ms))
+    {
+      int mcp = input_mcps[rng() % input_mcps.size()];
+      io_values[mcp] ^= 1 << (rng() % 16);
+      inputs++;
+    }
+
+    for (size_t i = 0; i < pending.size(); )
+    {
+      if ((int32_t)(now - pending[i].ms) >= 0)
+      {
+        set_port(io_values, pending[i].port, pending[i].state);
+        pending.erase(pending.begin() + i);
+      }
+      else
+      {
+        i++;
+      }
+    }
+
+    for (int mcp = 0; mcp < 8; mcp++)
+    {
+      rig.lcd.process(mcp, io_values[mcp]);
+    }
+    rig.lcd.loop();
+
+    hostClockAdvanceMs(poll_ms);
+  }
+
+  rig.lcd.stopRecording();
+  printf("%s: %d s, %d input changes, %d zone trips\n", argv[optind], seconds, inputs, trips);
+  return 0;
+}
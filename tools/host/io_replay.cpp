@@ -0,0 +1,252 @@
+/*
+ * io_replay.cpp
+ * replays an io trace through OXRS_LCD and reports what rendering it cost
+ *
+ * boots the layout of the trace, then feeds every record to process() (or the
+ * setPin... calls for config records) at its recorded time on the virtual
+ * clock, calling loop() every loop_ms in between as the firmware does and once
+ * right after every record to draw what it queued (counted with the record). io
+ * events closer than burst_ms to the previous one are grouped into a burst.
+ * the first event of every MCP repaints all its pins and is kept out of the
+ * event and burst figures.
+ *
+ *   io_replay [-p loop_ms] [-g burst_ms] [-v] [-R] [-f spi_hz] [-t transaction_us] [-d command_us] trace
+ *
+ *   -p   virtual time between loop() calls in ms (default 5)
+ *   -g   largest gap between two io events of one burst in ms (default 20)
+ *   -v   print every io event
+ *   -R   let the clock run on by the bus time of every draw and print getRenderStats()
+ *        and the pin change to painted latency percentiles
+ *   -f -t -d  override the bus timing (SCLK Hz, us per transaction, us per command)
+ */
+
+#include "host_rig.h"
+#include "io_trace.h"
+#include "spi_cost.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+struct event_cost
+{
+  uint32_t ms;
+  uint8_t  mcp;
+  uint16_t io_value;
+  size_t   draws;
+  double   bus_us;
+};
+
+struct burst_cost
+{
+  uint32_t start_ms;
+  uint32_t end_ms;
+  int      events;
+  size_t   draws;
+  double   bus_us;
+};
+
+static void print_render_stat(const char * name, const render_stat& stat)
+{
+  printf("%-16s %7u %9.1f %9u  ", name, stat.count, stat.count ? (double)stat.total_us / stat.count : 0.0, stat.max_us);
+  for (int bucket = 0; bucket < RENDER_STATS_BUCKETS; bucket++)
+  {
+    if (!stat.histogram[bucket]) continue;
+    if (bucket == 0)
+      printf(" <1:%u", stat.histogram[bucket]);
+    else
+      printf(" %u:%u", 1u << (bucket - 1), stat.histogram[bucket]);
+  }
+  printf("\n");
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  size_t i = (size_t)(p / 100.0 * (values.size() - 1) + 0.5);
+  return values[i];
+}
+
+int main(int argc, char ** argv)
+{
+  int loop_ms = 5;
+  int burst_ms = 20;
+  bool verbose = false;
+  bool show_stats = false;
+  spi_timing timing = spiTimingDefault();
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:g:vRf:t:d:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'p': loop_ms = atoi(optarg); break;
+      case 'g': burst_ms = atoi(optarg); break;
+      case 'v': verbose = true; break;
+      case 'R': show_stats = true; break;
+      case 'f': timing.spi_hz = strtoul(optarg, NULL, 0); break;
+      case 't': timing.transaction_us = atof(optarg); break;
+      case 'd': timing.command_us = atof(optarg); break;
+      default:
+        optind = argc + 1;
+    }
+  }
+  if (optind != argc - 1 || loop_ms < 1)
+  {
+    fprintf(stderr, "usage: %s [-p loop_ms] [-g burst_ms] [-v] [-R] [-f spi_hz] [-t transaction_us] [-d command_us] trace\n", argv[0]);
+    return 1;
+  }
+
+  io_trace trace;
+  std::string error;
+  if (!ioTraceLoad(argv[optind], trace, error))
+  {
+    fprintf(stderr, "%s: %s\n", argv[optind], error.c_str());
+    return 1;
+  }
+
+  host_rig rig;
+  TFT_eSPI * tft = rig.tft();
+  OXRS_LCD& lcd = rig.lcd;
+  spi_meter meter(tft, timing);
+
+  tft->hostRecord(false);
+  rig.boot(trace.port_layout, trace.mcps_found);
+  tft->hostRecord(true);
+  tft->hostBusReset();
+  lcd.resetRenderStats();
+  if (show_stats) spiBusClock(tft, timing);
+
+  io_trace_config config = {};
+  uint64_t base_us = hostClockMicros();
+  uint32_t next_loop_ms = loop_ms;
+  size_t loop_draws = 0, config_draws = 0, initial_draws = 0;
+  uint8_t mcps_seen = 0;
+
+  std::vector<event_cost> events;
+  std::vector<burst_cost> bursts;
+
+  for (const io_trace_record& record : trace.records)
+  {
+    // the firmware keeps calling loop() while nothing changes
+    while (next_loop_ms <= record.ms)
+    {
+      hostClockSet(base_us + (uint64_t)next_loop_ms * 1000);
+      tft->hostClearOps();
+      meter.measure("loop()", [&] { lcd.loop(); });
+      loop_draws += tft->hostOps().size();
+      next_loop_ms += loop_ms;
+    }
+    hostClockSet(base_us + (uint64_t)record.ms * 1000);
+    tft->hostClearOps();
+
+    if (record.config)
+    {
+      meter.measure("setPin...()", [&] { ioTraceApplyConfig(lcd, config, record); lcd.loop(); });
+      config_draws += tft->hostOps().size();
+      continue;
+    }
+
+    if (!bitRead(mcps_seen, record.mcp))
+    {
+      bitSet(mcps_seen, record.mcp);
+      meter.measure("process() initial", [&] { lcd.process(record.mcp, record.io_value); lcd.loop(); });
+      initial_draws += tft->hostOps().size();
+      continue;
+    }
+
+    event_cost event;
+    event.ms = record.ms;
+    event.mcp = record.mcp;
+    event.io_value = record.io_value;
+    event.bus_us = meter.measure("process()", [&] { lcd.process(record.mcp, record.io_value); lcd.loop(); });
+    event.draws = tft->hostOps().size();
+    events.push_back(event);
+
+    if (verbose)
+    {
+      printf("%10.3f s  mcp %u  %04x  %4zu draws  %8.1f us\n",
+        event.ms / 1000.0, event.mcp, event.io_value, event.draws, event.bus_us);
+    }
+
+    if (bursts.empty() || event.ms - bursts.back().end_ms > (uint32_t)burst_ms)
+    {
+      bursts.push_back({event.ms, event.ms, 0, 0, 0});
+    }
+    burst_cost& burst = bursts.back();
+    burst.end_ms = event.ms;
+    burst.events++;
+    burst.draws += event.draws;
+    burst.bus_us += event.bus_us;
+  }
+  tft->hostClearOps();
+
+  uint32_t duration_ms = trace.records.empty() ? 0 : trace.records.back().ms;
+  size_t event_draws = 0;
+  std::vector<double> event_us, event_draw_counts;
+  for (const event_cost& event : events)
+  {
+    event_draws += event.draws;
+    event_us.push_back(event.bus_us);
+    event_draw_counts.push_back(event.draws);
+  }
+
+  printf("trace     %s: layout %d, mcps 0x%02x, %zu records, %zu io events over %.1f s\n\n",
+    argv[optind], trace.port_layout, trace.mcps_found, trace.records.size(), events.size(), duration_ms / 1000.0);
+
+  meter.report(stdout);
+
+  printf("\n%-10s %9s %9s %9s %9s\n", "per event", "mean", "p50", "p99", "max");
+  if (!events.empty())
+  {
+    printf("%-10s %9.1f %9.1f %9.1f %9.1f\n", "draws",
+      (double)event_draws / events.size(),
+      percentile(event_draw_counts, 50), percentile(event_draw_counts, 99), percentile(event_draw_counts, 100));
+    printf("%-10s %9.1f %9.1f %9.1f %9.1f\n", "bus us",
+      std::accumulate(event_us.begin(), event_us.end(), 0.0) / events.size(),
+      percentile(event_us, 50), percentile(event_us, 99), percentile(event_us, 100));
+  }
+
+  if (!bursts.empty())
+  {
+    const burst_cost * worst = &bursts[0];
+    for (const burst_cost& burst : bursts)
+    {
+      if (burst.bus_us > worst->bus_us) worst = &burst;
+    }
+    printf("\nbursts    %zu (events at most %d ms apart)\n", bursts.size(), burst_ms);
+    printf("worst     at %.3f s: %d events over %u ms, %zu draws, %.1f us bus\n",
+      worst->start_ms / 1000.0, worst->events, worst->end_ms - worst->start_ms, worst->draws, worst->bus_us);
+  }
+
+  printf("\ndraws     %zu total: %zu process(), %zu loop(), %zu initial process() and setPin...()\n",
+    event_draws + loop_draws + config_draws + initial_draws, event_draws, loop_draws, config_draws + initial_draws);
+  if (duration_ms)
+  {
+    printf("bus busy  %.1f ms of %.1f s (%.2f %%)\n",
+      meter.totalMicros() / 1000, duration_ms / 1000.0, 100.0 * meter.totalMicros() / (duration_ms * 1000.0));
+  }
+
+  if (show_stats)
+  {
+    spiBusClock(NULL, timing);
+
+    const render_stats& stats = lcd.getRenderStats();
+    printf("\n%-16s %7s %9s %9s   histogram (from us:calls)\n", "getRenderStats()", "calls", "mean us", "max us");
+    print_render_stat("process", stats.process);
+    print_render_stat("loop", stats.loop);
+    print_render_stat("update_input", stats.update_input);
+    print_render_stat("update_output", stats.update_output);
+    print_render_stat("update_io_48", stats.update_io_48);
+    print_render_stat("update_security", stats.update_security);
+    print_render_stat("flush_draws", stats.flush_draws);
+    printf("\nlatency          %7u pin changes, p50 %u us, p90 %u us, p99 %u us, max %u us\n",
+      stats.latency.count, lcd.getLatencyPercentile(50), lcd.getLatencyPercentile(90),
+      lcd.getLatencyPercentile(99), stats.latency.max_us);
+  }
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * io_trace.cpp
+ * reader for the io traces written by OXRS_LCD::startRecording()
+ *
+ */
+
+#include "io_trace.h"
+
+#include <OXRS_LCD.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+static bool read_u16(FILE * f, uint16_t * value)
+{
+  int lo = fgetc(f);
+  int hi = fgetc(f);
+  if (lo == EOF || hi == EOF) return false;
+  *value = (uint16_t)(lo | (hi << 8));
+  return true;
+}
+
+// varint, 7 bits per byte, low first; false on a clean end of file
+static bool read_varint(FILE * f, uint64_t * value, bool * truncated)
+{
+  int shift = 0;
+  *value = 0;
+  *truncated = false;
+
+  for (;;)
+  {
+    int c = fgetc(f);
+    if (c == EOF)
+    {
+      *truncated = (shift != 0);
+      return false;
+    }
+    *value |= (uint64_t)(c & 0x7f) << shift;
+    if (!(c & 0x80)) return true;
+
+    shift += 7;
+    if (shift > 63)
+    {
+      *truncated = true;
+      return false;
+    }
+  }
+}
+
+bool ioTraceLoad(const char * path, io_trace& trace, std::string& error)
+{
+  FILE * f = fopen(path, "rb");
+  if (!f)
+  {
+    error = strerror(errno);
+    return false;
+  }
+
+  char magic[4];
+  int version;
+  uint16_t port_layout;
+  int mcps_found;
+
+  if (fread(magic, 1, 4, f) != 4 || memcmp(magic, IO_TRACE_MAGIC, 4) != 0)
+  {
+    error = "not an io trace";
+    fclose(f);
+    return false;
+  }
+  version = fgetc(f);
+  if (version != IO_TRACE_VERSION)
+  {
+    error = "unsupported io trace version " + std::to_string(version);
+    fclose(f);
+    return false;
+  }
+  if (!read_u16(f, &port_layout) || (mcps_found = fgetc(f)) == EOF)
+  {
+    error = "truncated header";
+    fclose(f);
+    return false;
+  }
+
+  trace.port_layout = port_layout;
+  trace.mcps_found = (uint8_t)mcps_found;
+  trace.records.clear();
+
+  uint64_t ms = 0;
+  uint64_t head;
+  bool truncated;
+
+  while (read_varint(f, &head, &truncated))
+  {
+    io_trace_record record;
+    memset(&record, 0, sizeof(record));
+
+    ms += head >> 4;
+    record.ms = (uint32_t)ms;
+    record.mcp = head & 0x07;
+    record.config = (head & IO_TRACE_CONFIG) != 0;
+
+    bool ok;
+    if (record.config)
+    {
+      ok = read_u16(f, &record.pin_type)
+        && read_u16(f, &record.pin_invert)
+        && read_u16(f, &record.pin_disabled);
+    }
+    else
+    {
+      ok = read_u16(f, &record.io_value);
+    }
+    if (!ok)
+    {
+      truncated = true;
+      break;
+    }
+    trace.records.push_back(record);
+  }
+  fclose(f);
+
+  // a recording cut short (power loss, full file system) keeps what is complete
+  if (truncated)
+  {
+    fprintf(stderr, "%s: truncated after %zu records\n", path, trace.records.size());
+  }
+  return true;
+}
+
+void ioTraceApplyConfig(OXRS_LCD& lcd, io_trace_config& config, const io_trace_record& record)
+{
+  int mcp = record.mcp;
+
+  for (int pin = 0; pin < 16; pin++)
+  {
+    if (bitRead(config.pin_type[mcp] ^ record.pin_type, pin))
+      lcd.setPinType(mcp, pin, bitRead(record.pin_type, pin));
+    if (bitRead(config.pin_invert[mcp] ^ record.pin_invert, pin))
+      lcd.setPinInvert(mcp, pin, bitRead(record.pin_invert, pin));
+    if (bitRead(config.pin_disabled[mcp] ^ record.pin_disabled, pin))
+      lcd.setPinDisabled(mcp, pin, bitRead(record.pin_disabled, pin));
+  }
+  config.pin_type[mcp] = record.pin_type;
+  config.pin_invert[mcp] = record.pin_invert;
+  config.pin_disabled[mcp] = record.pin_disabled;
+}
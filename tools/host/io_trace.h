@@ -0,0 +1,48 @@
+/*
+ * io_trace.h
+ * reader for the io traces written by OXRS_LCD::startRecording()
+ *
+ */
+
+#ifndef IO_TRACE_H
+#define IO_TRACE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct io_trace_record
+{
+  uint32_t ms;              // since the start of the recording
+  uint8_t  mcp;
+  bool     config;          // pin config below, otherwise io_value
+  uint16_t io_value;
+  uint16_t pin_type;
+  uint16_t pin_invert;
+  uint16_t pin_disabled;
+};
+
+struct io_trace
+{
+  int                           port_layout;
+  uint8_t                       mcps_found;
+  std::vector<io_trace_record>  records;
+};
+
+// pin config of a replay, as set by the config records so far
+struct io_trace_config
+{
+  uint16_t pin_type[8];
+  uint16_t pin_invert[8];
+  uint16_t pin_disabled[8];
+};
+
+class OXRS_LCD;
+
+// false with a reason in error when the file is missing, not a trace or truncated
+bool ioTraceLoad(const char * path, io_trace& trace, std::string& error);
+
+// apply the pins of a config record that differ from config with setPin...()
+void ioTraceApplyConfig(OXRS_LCD& lcd, io_trace_config& config, const io_trace_record& record);
+
+#endif
@@ -0,0 +1,540 @@
+/*
+ * lcd_golden.cpp
+ * golden image check of the host build of OXRS_LCD
+ *
+ * renders fixed scenes into the framebuffer of the TFT_eSPI stand-in and
+ * compares the CRC-32 of every frame with a golden file:
+ *
+ *   layout ...     boot of every PORT_LAYOUT_... (header, ports, link up,
+ *                  every MCP reporting all inputs high)
+ *   security ...   the security port states on MCP 0 of PORT_LAYOUT_INPUT_128
+ *                  (normal, alarm, tamper, fault) in both flash phases,
+ *                  inverted and disabled
+ *   config ...     pin invert and disable set three times over at boot, on
+ *                  the inputs and outputs of PORT_LAYOUT_IO_64_64
+ *   diagnostics .. the diagnostics page after a window with pin changes, and
+ *                  the screen once it is hidden again. the timing figures
+ *                  (loop/s, longest loop, SPI load) are masked
+ *   status ...     an event and the MQTT rx/tx LEDs, shown and cleared again
+ *                  by their timers. with a budget, after a burst of pin
+ *                  changes that exhausts it, the port LEDs are painted first,
+ *                  and all of them once the budget is set to 0
+ *
+ * the layout and security scenes are rendered again with each shadow buffer
+ * mode (setShadowBuffer), every frame has to match the one drawn without and
+ * the shadow has to stay on. the layout and security scenes are rendered
+ * once more through host_transport, the DMA stand-in: frames have to match, the
+ * draw buffers must not be written while in flight and every push has to be
+ * on the screen when process() or loop() return. the same scenes run with the
+ * render queue, drained by a thread of their own while the pins of every
+ * layout churn, and have to end on the same frames. with the queue on and
+ * nothing draining it the calls have to return. last with a render
+ * budget and the clock run on by the SPI bus time, pin churn has to be left
+ * to later loop() calls and the frames have to match once it is painted.
+ * the status scenes run with the queue and the budget as well.
+ * the layout and security scenes boot once more with the header and ports
+ * drawn by loop() in slices, the MCPs reporting meanwhile, then again with
+ * the slices pushed through host_transport
+ *
+ *   lcd_golden [-d dir] [-u] [golden]
+ *
+ *   -d   write every frame as <dir>/<scene>.ppm
+ *   -u   write the CRCs to golden instead of checking them
+ *
+ * golden defaults to golden.txt, exit 1 when a frame differs or is missing
+ */
+
+#include "host_rig.h"
+#include "host_transport.h"
+#include "spi_cost.h"
+
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// the render budget of the budget variant, a few chunks per loop()
+#define     GOLDEN_BUDGET_US            2000
+
+// one nibble per port, port 0 in the low nibble: normal, alarm, tamper, fault
+#define     SECURITY_IO_VALUE           0xf215
+
+struct golden_frame
+{
+  std::string name;
+  uint32_t    crc;
+};
+
+static std::vector<golden_frame> frames;
+static const char * dump_dir = NULL;
+
+// the scene being rendered with a shadow buffer, through a transport or
+// another variant, frames are checked against the plain ones instead
+// of kept
+static int shadow = SHADOW_OFF;
+static bool dma = false;
+static bool queued = false;
+static uint32_t budget = 0;
+static uint32_t budget_carried = 0;
+static bool sliced = false;
+static int sliced_loops = 0;
+static host_transport * transport = NULL;
+static uint32_t transport_overlapped = 0;
+static const char * variant = NULL;
+static int variant_failures = 0;
+
+static void capture(host_rig& rig, const std::string& name)
+{
+  TFT_eSPI * tft = rig.tft();
+  if (queued) rig.render.stop();
+  while (rig.lcd.getPendingRepaints())
+  {
+    budget_carried++;
+    rig.lcd.loop();
+  }
+  golden_frame frame = {name, tft->hostFramebufferCrc()};
+
+  if (variant)
+  {
+    for (const golden_frame& plain : frames)
+    {
+      if (plain.name != name) continue;
+      if (plain.crc != frame.crc)
+      {
+        printf("VARIANT  %-28s %08x with %s, %08x without\n", name.c_str(), frame.crc, variant, plain.crc);
+        variant_failures++;
+      }
+    }
+    if (rig.lcd.getShadowBuffer() != shadow)
+    {
+      printf("VARIANT  %-28s %s turned off\n", name.c_str(), variant);
+      variant_failures++;
+    }
+    if (transport && transport->hostFailures())
+    {
+      printf("VARIANT  %-28s %s: %s\n", name.c_str(), variant, transport->hostFirstFailure().c_str());
+      variant_failures++;
+    }
+    if (transport && transport->hostInFlight())
+    {
+      printf("VARIANT  %-28s %s: push still in flight\n", name.c_str(), variant);
+      variant_failures++;
+    }
+    return;
+  }
+  frames.push_back(frame);
+
+  if (dump_dir)
+  {
+    std::string path = std::string(dump_dir) + "/" + name + ".ppm";
+    if (!tft->hostWritePPM(path.c_str()))
+    {
+      perror(path.c_str());
+      exit(1);
+    }
+  }
+}
+
+// fresh screen and clock for every scene, the clock runs on by the bus time
+// with a budget
+static void start(host_rig& rig)
+{
+  spiBusClock((budget || sliced) ? rig.tft() : NULL, spiTimingDefault());
+  hostClockSet(0);
+  rig.tft()->hostRecord(false);
+  rig.tft()->hostFramebuffer(true);
+}
+
+// random io_values on every MCP, posted as fast as the render thread takes
+// them (and faster), back to the ones of boot at the end
+static void churn(host_rig& rig)
+{
+  uint32_t seed = 1;
+  for (int i = 0; i < 4096; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    rig.lcd.process(i & 7, seed >> 16);
+    if ((i & 63) == 63) rig.lcd.loop();
+  }
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    rig.lcd.process(mcp, 0xffff);
+  }
+  rig.lcd.loop();
+}
+
+// the transport of a scene, when rendered through one
+struct scene_transport
+{
+  host_transport stand_in;
+
+  scene_transport(host_rig& rig) : stand_in(*rig.tft()) { transport = dma ? &stand_in : NULL; }
+  ~scene_transport()
+  {
+    transport_overlapped += stand_in.hostOverlapped();
+    transport = NULL;
+  }
+};
+
+static void render_layout(const host_layout& layout)
+{
+  host_rig rig;
+  scene_transport scene(rig);
+  start(rig);
+  rig.boot(layout.port_layout, 0xff, shadow, transport, queued, sliced);
+  if (rig.sliced_loops > sliced_loops) sliced_loops = rig.sliced_loops;
+  rig.lcd.setRenderBudget(budget);
+  if (queued || budget) churn(rig);
+  capture(rig, std::string("layout_") + layout.name);
+}
+
+static void render_security(void)
+{
+  host_rig rig;
+  scene_transport scene(rig);
+  start(rig);
+  rig.boot(PORT_LAYOUT_INPUT_128, 0xff, shadow, transport, queued, sliced);
+  rig.lcd.setRenderBudget(budget);
+
+  for (int pin = 0; pin < 16; pin++)
+  {
+    rig.lcd.setPinType(0, pin, PIN_TYPE_SECURITY);
+  }
+  rig.lcd.process(0, SECURITY_IO_VALUE);
+  rig.lcd.loop();
+  capture(rig, "security_states");
+
+  // tamper and fault flash, the first phase starts one flash period after boot
+  hostClockAdvanceMs(LCD_PORT_FLASH_ON_MS + 1);
+  rig.lcd.loop();
+  capture(rig, "security_flash_on");
+
+  hostClockAdvanceMs(LCD_PORT_FLASH_ON_MS + 1);
+  rig.lcd.loop();
+  capture(rig, "security_flash_off");
+
+  // invert swaps normal and alarm, it is read from the last pin of a port
+  rig.lcd.setPinInvert(0, 3, 1);
+  rig.lcd.setPinInvert(0, 7, 1);
+  rig.lcd.process(0, SECURITY_IO_VALUE);
+  rig.lcd.loop();
+  capture(rig, "security_inverted");
+
+  rig.lcd.setPinDisabled(0, 11, 1);
+  rig.lcd.setPinDisabled(0, 15, 1);
+  rig.lcd.process(0, SECURITY_IO_VALUE);
+  rig.lcd.loop();
+  capture(rig, "security_disabled");
+}
+
+// a burst of pin config at boot on the hybrid layout, repeated the way MQTT
+// config messages come in. only the pins whose config changed look different
+static void render_config(void)
+{
+  host_rig rig;
+  start(rig);
+  rig.boot(PORT_LAYOUT_IO_64_64, 0xff);
+
+  for (int round = 0; round < 3; round++)
+  {
+    for (int pin = 0; pin < 16; pin++)
+    {
+      rig.lcd.setPinInvert(0, pin, pin == 4);
+      rig.lcd.setPinDisabled(0, pin, pin == 9);
+      rig.lcd.setPinInvert(4, pin, pin < 3);
+    }
+    rig.lcd.process(0, 0xffff);
+    rig.lcd.process(4, 0xffff);
+    rig.lcd.loop();
+  }
+  capture(rig, "config_burst");
+}
+
+// a figure of the diagnostics page, where _draw_diag_value() puts it
+static void mask_diag_value(host_rig& rig, int col, int row, int width)
+{
+  rig.tft()->hostMask(12 + col * 9, Y_INFO + row * 15, width * 9, 13);
+}
+
+static void render_diagnostics(void)
+{
+  host_rig rig;
+  start(rig);
+  rig.boot(PORT_LAYOUT_INPUT_128, 0xff);
+
+  rig.lcd.showDiagnostics(true);
+  rig.lcd.process(0, 0xfff0);
+  rig.lcd.process(5, 0x00ff);
+  hostClockAdvanceMs(DIAG_WINDOW_MS);
+  rig.lcd.loop();
+  // loop/s, the longest loop and the SPI load follow how many loop() calls
+  // and how much bus time the code takes, not what the page shows
+  mask_diag_value(rig, 5, 0, 5);
+  mask_diag_value(rig, 17, 0, 6);
+  mask_diag_value(rig, 7, 1, 3);
+  capture(rig, "diagnostics_shown");
+  rig.tft()->hostUnmask();
+
+  rig.lcd.process(0, 0xffff);
+  rig.lcd.process(5, 0xffff);
+  rig.lcd.showDiagnostics(false);
+  rig.lcd.loop();
+  capture(rig, "diagnostics_hidden");
+}
+
+static void render_status(void)
+{
+  host_rig rig;
+  start(rig);
+  rig.boot(PORT_LAYOUT_INPUT_128, 0xff, SHADOW_OFF, NULL, queued);
+  rig.lcd.setRenderBudget(budget);
+
+  // the timers take millis() 0 for none
+  hostClockAdvanceMs(1);
+  rig.lcd.showEvent("IN 12 PRESS");
+  rig.lcd.triggerMqttRxLed();
+  rig.lcd.triggerMqttTxLed();
+
+  // with every input changed at once the budget runs out on the port LEDs,
+  // the event bar is painted after them
+  if (budget && !queued)
+  {
+    for (int mcp = 0; mcp < 8; mcp++)
+    {
+      rig.lcd.process(mcp, 0x0000);
+    }
+    rig.lcd.loop();
+    if (!rig.lcd.getPendingRepaints())
+    {
+      printf("VARIANT  %-28s the burst fit one loop()\n", "budget");
+      variant_failures++;
+    }
+    else if (rig.tft()->hostPixel(200, 230) != TFT_DARKGREY)
+    {
+      printf("VARIANT  %-28s the event bar was painted before the port LEDs\n", "budget");
+      variant_failures++;
+    }
+
+    // the budget taken away paints what it left
+    rig.lcd.setRenderBudget(0);
+    if (rig.lcd.getPendingRepaints())
+    {
+      printf("VARIANT  %-28s setRenderBudget(0) left repaints pending\n", "budget");
+      variant_failures++;
+    }
+    rig.lcd.setRenderBudget(budget);
+  }
+  if (queued || budget) churn(rig);
+  else rig.lcd.loop();
+  capture(rig, "status_shown");
+
+  hostClockAdvanceMs(LCD_EVENT_MS + 1);
+  rig.lcd.loop();
+  capture(rig, "status_cleared");
+}
+
+// the queue on with nothing draining it: the firmware side gives up waiting,
+// drops what finds no room and the getters return, until a render thread runs
+static void check_stalled_queue(void)
+{
+  host_rig rig;
+  start(rig);
+  rig.boot(PORT_LAYOUT_INPUT_128, 0xff);
+  rig.lcd.setRenderQueue(true);
+
+  for (int i = 0; i < RENDER_QUEUE_RECORDS + 8; i++)
+  {
+    rig.lcd.setPinInvert(0, i & 15, i & 1);
+  }
+  rig.lcd.startRecording(NULL);
+  if (!rig.lcd.getRenderStats().queue_dropped)
+  {
+    printf("VARIANT  %-28s nothing dropped with no render side\n", "render_queue");
+    variant_failures++;
+  }
+  if (!rig.lcd.screenDrawn())
+  {
+    printf("VARIANT  %-28s the screen is not drawn with no render side\n", "render_queue");
+    variant_failures++;
+  }
+
+  rig.render.start(rig.lcd);
+  rig.lcd.process(0, 0x0000);
+  if (!rig.lcd.getRenderStats().process.count)
+  {
+    printf("VARIANT  %-28s no stats once the render thread runs\n", "render_queue");
+    variant_failures++;
+  }
+  rig.render.stop();
+}
+
+static bool load_golden(const char * path, std::map<std::string, uint32_t>& golden)
+{
+  FILE * f = fopen(path, "r");
+  if (!f) return false;
+
+  char name[128];
+  unsigned int crc;
+  while (fscanf(f, "%127s %x", name, &crc) == 2)
+  {
+    golden[name] = crc;
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char ** argv)
+{
+  const char * golden_path = "golden.txt";
+  bool update = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:u")) != -1)
+  {
+    switch (opt)
+    {
+      case 'd': dump_dir = optarg; break;
+      case 'u': update = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-d dir] [-u] [golden]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (optind < argc) golden_path = argv[optind];
+
+  for (size_t i = 0; i < HOST_LAYOUT_COUNT; i++)
+  {
+    render_layout(host_layouts[i]);
+  }
+  render_security();
+  render_config();
+  render_diagnostics();
+  render_status();
+
+  for (shadow = SHADOW_RGB565; shadow <= SHADOW_PALETTE; shadow++)
+  {
+    variant = (shadow == SHADOW_RGB565) ? "rgb565" : "palette";
+    for (size_t i = 0; i < HOST_LAYOUT_COUNT; i++)
+    {
+      render_layout(host_layouts[i]);
+    }
+    render_security();
+  }
+  shadow = SHADOW_OFF;
+
+  variant = "host_transport";
+  dma = true;
+  for (size_t i = 0; i < HOST_LAYOUT_COUNT; i++)
+  {
+    render_layout(host_layouts[i]);
+  }
+  render_security();
+  dma = false;
+
+  variant = "render_queue";
+  queued = true;
+  for (size_t i = 0; i < HOST_LAYOUT_COUNT; i++)
+  {
+    render_layout(host_layouts[i]);
+  }
+  render_security();
+  render_status();
+  queued = false;
+  check_stalled_queue();
+
+  variant = "budget";
+  budget = GOLDEN_BUDGET_US;
+  for (size_t i = 0; i < HOST_LAYOUT_COUNT; i++)
+  {
+    render_layout(host_layouts[i]);
+  }
+  render_security();
+  render_status();
+  budget = 0;
+
+  variant = "sliced";
+  sliced = true;
+  for (size_t i = 0; i < HOST_LAYOUT_COUNT; i++)
+  {
+    render_layout(host_layouts[i]);
+  }
+  render_security();
+
+  variant = "sliced_transport";
+  dma = true;
+  for (size_t i = 0; i < HOST_LAYOUT_COUNT; i++)
+  {
+    render_layout(host_layouts[i]);
+  }
+  render_security();
+  dma = false;
+  sliced = false;
+  spiBusClock(NULL, spiTimingDefault());
+  variant = NULL;
+
+  // the second draw buffer is never rendered into while the first is sent
+  if (!transport_overlapped)
+  {
+    printf("VARIANT  %-28s no push overlapped the one before\n", "host_transport");
+    variant_failures++;
+  }
+
+  // the churn did not fit one loop() at a time
+  if (!budget_carried)
+  {
+    printf("VARIANT  %-28s no repaint was left to a later loop()\n", "budget");
+    variant_failures++;
+  }
+
+  // the boot screen took more than the two loop() calls of boot
+  if (sliced_loops <= 2)
+  {
+    printf("VARIANT  %-28s the screen was drawn in one loop()\n", "sliced");
+    variant_failures++;
+  }
+
+  if (update)
+  {
+    FILE * f = fopen(golden_path, "w");
+    if (!f)
+    {
+      perror(golden_path);
+      return 1;
+    }
+    for (const golden_frame& frame : frames)
+    {
+      fprintf(f, "%-28s %08x\n", frame.name.c_str(), frame.crc);
+    }
+    fclose(f);
+    printf("%zu frames written to %s\n", frames.size(), golden_path);
+    return 0;
+  }
+
+  std::map<std::string, uint32_t> golden;
+  if (!load_golden(golden_path, golden))
+  {
+    perror(golden_path);
+    return 1;
+  }
+
+  int failures = 0;
+  for (const golden_frame& frame : frames)
+  {
+    auto it = golden.find(frame.name);
+    if (it == golden.end())
+    {
+      printf("MISSING  %-28s %08x\n", frame.name.c_str(), frame.crc);
+      failures++;
+    }
+    else if (it->second != frame.crc)
+    {
+      printf("DIFFERS  %-28s %08x, golden %08x\n", frame.name.c_str(), frame.crc, it->second);
+      failures++;
+    }
+  }
+  failures += variant_failures;
+  printf("%zu frames, %d failure(s) against %s\n", frames.size(), failures, golden_path);
+  return failures ? 1 : 0;
+}
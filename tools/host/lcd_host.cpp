@@ -0,0 +1,137 @@
+/*
+ * lcd_host.cpp
+ * smoke driver for the host build of OXRS_LCD
+ *
+ * runs a short scripted session (boot, link up, input changes, event, timeouts,
+ * diagnostics page)
+ * and prints the primitives recorded by the TFT_eSPI stand-in for each step
+ *
+ *   lcd_host [-l port_layout] [-m mcps_found] [-w] [-v]
+ *
+ *   -l   PORT_LAYOUT_... value (default 1128, PORT_LAYOUT_INPUT_128)
+ *   -m   bitmask of MCPs found (default 0xff)
+ *   -w   use the WiFi constructor instead of Ethernet
+ *   -v   dump every recorded primitive
+ */
+
+#include <OXRS_LCD.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static bool verbose = false;
+
+static void report(OXRS_LCD& lcd, const char * step)
+{
+  TFT_eSPI * tft = lcd.getTft();
+
+  printf("%-24s %5zu ops :", step, tft->hostOps().size());
+  for (int kind = 0; kind < TFT_OP_KIND_COUNT; kind++)
+  {
+    size_t count = tft->hostOpCount((tft_op_kind)kind);
+    if (count) printf(" %s=%zu", tftOpName((tft_op_kind)kind), count);
+  }
+  printf("\n");
+
+  if (verbose)
+  {
+    for (const tft_op& op : tft->hostOps())
+    {
+      printf("    %-14s x=%-4d y=%-4d w=%-4d h=%-4d r=%-2d color=0x%04x bg=0x%04x %s\n",
+        tftOpName(op.kind), op.x, op.y, op.w, op.h, op.r, op.color, op.bg, op.text.c_str());
+    }
+  }
+
+  tft->hostClearOps();
+}
+
+int main(int argc, char ** argv)
+{
+  int port_layout = PORT_LAYOUT_INPUT_128;
+  int mcps_found = 0xff;
+  bool use_wifi = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "l:m:wv")) != -1)
+  {
+    switch (opt)
+    {
+      case 'l': port_layout = strtol(optarg, NULL, 0); break;
+      case 'm': mcps_found = strtol(optarg, NULL, 0); break;
+      case 'w': use_wifi = true; break;
+      case 'v': verbose = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-l port_layout] [-m mcps_found] [-w] [-v]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  EthernetClass ethernet;
+  WiFiClass wifi;
+  OXRS_MQTT mqtt;
+  OXRS_LCD lcd = use_wifi ? OXRS_LCD(wifi, mqtt) : OXRS_LCD(ethernet, mqtt);
+
+  lcd.begin();
+  report(lcd, "begin()");
+
+  lcd.drawHeader("host", "OXRS", "0.0.0", "linux");
+  report(lcd, "drawHeader()");
+
+  lcd.drawPorts(port_layout, mcps_found);
+  report(lcd, "drawPorts()");
+
+  lcd.loop();
+  report(lcd, "loop() link down");
+
+  ethernet.hostSetLink(LinkON);
+  ethernet.hostSetIP(IPAddress(192, 168, 1, 42));
+  wifi.hostSetStatus(WL_CONNECTED);
+  wifi.hostSetIP(IPAddress(192, 168, 1, 43));
+  mqtt.hostSetConnected(true);
+  hostClockAdvanceMs(10);
+  lcd.loop();
+  report(lcd, "loop() link up");
+
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    lcd.process(mcp, 0xffff);
+  }
+  lcd.loop();
+  report(lcd, "process() initial");
+
+  lcd.process(0, 0xfffe);
+  lcd.loop();
+  report(lcd, "process() 1 pin");
+
+  lcd.process(1, 0x0000);
+  lcd.loop();
+  report(lcd, "process() 16 pins");
+
+  lcd.showEvent("host event");
+  lcd.triggerMqttRxLed();
+  report(lcd, "showEvent() + rx led");
+
+  hostClockAdvanceMs(LCD_ON_MS + 1);
+  lcd.loop();
+  report(lcd, "loop() timeouts");
+
+  lcd.showDiagnostics(true);
+  report(lcd, "showDiagnostics()");
+
+  lcd.process(0, 0xffff);
+  hostClockAdvanceMs(DIAG_WINDOW_MS);
+  lcd.loop();
+  report(lcd, "loop() diagnostics");
+
+  hostClockAdvanceMs(DIAG_WINDOW_MS);
+  lcd.loop();
+  report(lcd, "loop() diagnostics idle");
+
+  lcd.showDiagnostics(false);
+  lcd.loop();
+  report(lcd, "hideDiagnostics + loop()");
+
+  printf("backlight duty %u\n", hostLedcDuty(BL_PWM_CHANNEL));
+  return 0;
+}
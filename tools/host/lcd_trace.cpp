@@ -0,0 +1,161 @@
+/*
+ * lcd_trace.cpp
+ * timeline of an OXRS_LCD session as Chrome trace-event JSON
+ *
+ * without a trace file runs a short scripted session: boot, a zone trip on a
+ * security MCP (ALARM plus a flashing TAMPER), an input event and two seconds
+ * of loop(). with an io trace (see io_record / OXRS_LCD::startRecording())
+ * replays that instead.
+ *
+ *   lcd_trace [-o json] [-l port_layout] [-p loop_ms] [-s seconds] [-H] [io_trace]
+ *
+ *   -o   output file (default build/lcd_trace.json)
+ *   -l   PORT_LAYOUT_... value of the scripted session (default 1128)
+ *   -p   virtual time between loop() calls in ms (default 5)
+ *   -s   stop the replay after seconds of the io trace (default all)
+ *   -H   timestamps in host CPU time instead of the device estimate
+ */
+
+#include "chrome_trace.h"
+#include "host_rig.h"
+#include "io_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void loop_for(OXRS_LCD& lcd, uint32_t ms, int loop_ms)
+{
+  for (uint32_t t = 0; t < ms; t += loop_ms)
+  {
+    hostClockAdvanceMs(loop_ms);
+    lcd.loop();
+  }
+}
+
+static void scripted(host_rig& rig, int port_layout, int loop_ms)
+{
+  OXRS_LCD& lcd = rig.lcd;
+
+  rig.boot(port_layout, 0xff);
+  loop_for(lcd, 100, loop_ms);
+
+  // security sensors on mcp 0, all NORMAL
+  for (int pin = 0; pin < 16; pin++)
+  {
+    lcd.setPinType(0, pin, PIN_TYPE_SECURITY);
+  }
+  lcd.process(0, 0x5555);
+  loop_for(lcd, 100, loop_ms);
+
+  // zone trip: two ports to ALARM, one to TAMPER within a few ms
+  lcd.process(0, 0x5551);
+  hostClockAdvanceMs(2);
+  lcd.process(0, 0x5511);
+  hostClockAdvanceMs(3);
+  lcd.process(0, 0x5211);
+  lcd.showEvent("ZONE 1 ALARM");
+  loop_for(lcd, 2000, loop_ms);
+
+  // a button press on mcp 1
+  lcd.process(1, 0xfffe);
+  loop_for(lcd, 100, loop_ms);
+  lcd.process(1, 0xffff);
+  loop_for(lcd, 100, loop_ms);
+}
+
+static void replay(host_rig& rig, const io_trace& trace, int loop_ms, int seconds)
+{
+  OXRS_LCD& lcd = rig.lcd;
+  io_trace_config config = {};
+
+  rig.boot(trace.port_layout, trace.mcps_found);
+
+  uint64_t base_us = hostClockMicros();
+  uint32_t next_loop_ms = loop_ms;
+
+  for (const io_trace_record& record : trace.records)
+  {
+    if (seconds && record.ms > (uint32_t)seconds * 1000) break;
+
+    while (next_loop_ms <= record.ms)
+    {
+      hostClockSet(base_us + (uint64_t)next_loop_ms * 1000);
+      lcd.loop();
+      next_loop_ms += loop_ms;
+    }
+    hostClockSet(base_us + (uint64_t)record.ms * 1000);
+
+    if (record.config)
+    {
+      ioTraceApplyConfig(lcd, config, record);
+    }
+    else
+    {
+      lcd.process(record.mcp, record.io_value);
+    }
+  }
+}
+
+int main(int argc, char ** argv)
+{
+  const char * out_path = "build/lcd_trace.json";
+  int port_layout = PORT_LAYOUT_INPUT_128;
+  int loop_ms = 5;
+  int seconds = 0;
+  chrome_trace_clock clock = CHROME_TRACE_DEVICE;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:l:p:s:H")) != -1)
+  {
+    switch (opt)
+    {
+      case 'o': out_path = optarg; break;
+      case 'l': port_layout = strtol(optarg, NULL, 0); break;
+      case 'p': loop_ms = atoi(optarg); break;
+      case 's': seconds = atoi(optarg); break;
+      case 'H': clock = CHROME_TRACE_HOST; break;
+      default:
+        optind = argc + 1;
+    }
+  }
+  if (optind < argc - 1 || optind > argc || loop_ms < 1)
+  {
+    fprintf(stderr, "usage: %s [-o json] [-l port_layout] [-p loop_ms] [-s seconds] [-H] [io_trace]\n", argv[0]);
+    return 1;
+  }
+
+  io_trace trace;
+  if (optind == argc - 1)
+  {
+    std::string error;
+    if (!ioTraceLoad(argv[optind], trace, error))
+    {
+      fprintf(stderr, "%s: %s\n", argv[optind], error.c_str());
+      return 1;
+    }
+  }
+
+  host_rig rig;
+  rig.tft()->hostRecord(false);
+
+  if (!chromeTraceOpen(out_path, rig.tft(), spiTimingDefault(), clock))
+  {
+    perror(out_path);
+    return 1;
+  }
+
+  if (optind == argc - 1)
+  {
+    replay(rig, trace, loop_ms, seconds);
+  }
+  else
+  {
+    scripted(rig, port_layout, loop_ms);
+  }
+
+  size_t events = chromeTraceEvents();
+  chromeTraceClose();
+  printf("%s: %zu trace events\n", out_path, events);
+  return 0;
+}
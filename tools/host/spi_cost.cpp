@@ -0,0 +1,107 @@
+/*
+ * spi_cost.cpp
+ * SPI bus cost model for the RACK32 ST7789
+ *
+ */
+
+#include "spi_cost.h"
+
+// ESP32 SPI master, measured orders of magnitude rather than exact figures,
+// both can be overridden on the command line of the tools
+#define     SPI_TRANSACTION_US          1.5
+#define     SPI_COMMAND_US              0.3
+
+spi_timing spiTimingDefault(void)
+{
+  spi_timing timing;
+  timing.spi_hz = SPI_FREQUENCY;
+  timing.transaction_us = SPI_TRANSACTION_US;
+  timing.command_us = SPI_COMMAND_US;
+  return timing;
+}
+
+uint32_t spiBusBytes(const tft_bus_stats& stats)
+{
+  return stats.commands + stats.param_bytes + stats.pixel_bytes;
+}
+
+double spiBusMicros(const tft_bus_stats& stats, const spi_timing& timing)
+{
+  double wire_us = (double)spiBusBytes(stats) * 8.0 * 1e6 / timing.spi_hz;
+  return wire_us + stats.transactions * timing.transaction_us + stats.commands * timing.command_us;
+}
+
+static TFT_eSPI *   clock_tft = NULL;
+static spi_timing   clock_timing;
+static double       clock_busy_us = 0;
+static double       clock_last_us = 0;
+
+// busy time so far, carried over hostBusReset()
+static uint64_t bus_clock_busy(void)
+{
+  double us = spiBusMicros(clock_tft->hostBusStats(), clock_timing);
+  if (us < clock_last_us) clock_last_us = 0;
+  clock_busy_us += us - clock_last_us;
+  clock_last_us = us;
+  return (uint64_t)clock_busy_us;
+}
+
+void spiBusClock(TFT_eSPI * tft, const spi_timing& timing)
+{
+  clock_tft = tft;
+  clock_timing = timing;
+  clock_busy_us = 0;
+  clock_last_us = tft ? spiBusMicros(tft->hostBusStats(), timing) : 0;
+  hostClockBusy(tft ? bus_clock_busy : NULL);
+}
+
+double spi_meter::_add(const char * label, const tft_bus_stats& delta)
+{
+  double us = spiBusMicros(delta, _timing);
+
+  entry * e = NULL;
+  for (entry& candidate : _entries)
+  {
+    if (candidate.label == label) e = &candidate;
+  }
+  if (!e)
+  {
+    _entries.push_back(entry{label, 0, 0, 0, {}});
+    e = &_entries.back();
+  }
+
+  e->calls++;
+  e->total_us += us;
+  if (us > e->max_us) e->max_us = us;
+  e->bus.transactions += delta.transactions;
+  e->bus.windows += delta.windows;
+  e->bus.commands += delta.commands;
+  e->bus.param_bytes += delta.param_bytes;
+  e->bus.pixel_bytes += delta.pixel_bytes;
+  return us;
+}
+
+double spi_meter::totalMicros(void) const
+{
+  double total = 0;
+  for (const entry& e : _entries) total += e.total_us;
+  return total;
+}
+
+void spi_meter::report(FILE * out) const
+{
+  fprintf(out, "%-22s %7s %11s %11s %11s %9s %9s %9s\n",
+    "call", "calls", "us/call", "max us", "bytes/call", "win/call", "cs/call", "total ms");
+
+  for (const entry& e : _entries)
+  {
+    double calls = e.calls ? e.calls : 1;
+    fprintf(out, "%-22s %7u %11.1f %11.1f %11.0f %9.1f %9.1f %9.2f\n",
+      e.label.c_str(), e.calls,
+      e.total_us / calls, e.max_us,
+      spiBusBytes(e.bus) / calls,
+      e.bus.windows / calls,
+      e.bus.transactions * 2 / calls,
+      e.total_us / 1000);
+  }
+}
@@ -0,0 +1,70 @@
+/*
+ * spi_cost.h
+ * SPI bus cost model for the RACK32 ST7789
+ *
+ * turns the bus traffic counted by the TFT_eSPI stand-in into an estimate of
+ * how long the bus is busy, and accounts it per OXRS_LCD API call
+ */
+
+#ifndef SPI_COST_H
+#define SPI_COST_H
+
+#include <TFT_eSPI.h>
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+typedef struct
+{
+  uint32_t spi_hz;            // SCLK, SPI_FREQUENCY of the user setup
+  double   transaction_us;    // CS toggles plus SPI transaction begin/end
+  double   command_us;        // DC toggle before/after a command byte, waits for the FIFO to drain
+} spi_timing;
+
+spi_timing spiTimingDefault(void);
+uint32_t spiBusBytes(const tft_bus_stats& stats);
+double spiBusMicros(const tft_bus_stats& stats, const spi_timing& timing);
+
+// let the virtual clock run on by the bus time of every draw (NULL tft to stop)
+void spiBusClock(TFT_eSPI * tft, const spi_timing& timing);
+
+/*
+ * per call accounting, wrap every call of interest in measure()
+ */
+class spi_meter
+{
+  public:
+    spi_meter(TFT_eSPI * tft, const spi_timing& timing) : _tft(tft), _timing(timing) {}
+
+    template <typename F>
+    double measure(const char * label, F call)
+    {
+      tft_bus_stats before = _tft->hostBusStats();
+      call();
+      tft_bus_stats delta = tftBusDelta(_tft->hostBusStats(), before);
+      return _add(label, delta);
+    }
+
+    double totalMicros(void) const;
+    void report(FILE * out) const;
+    void reset(void) { _entries.clear(); }
+
+  private:
+    struct entry
+    {
+      std::string   label;
+      uint32_t      calls;
+      double        total_us;
+      double        max_us;
+      tft_bus_stats bus;
+    };
+
+    double _add(const char * label, const tft_bus_stats& delta);
+
+    TFT_eSPI *          _tft;
+    spi_timing          _timing;
+    std::vector<entry>  _entries;
+};
+
+#endif
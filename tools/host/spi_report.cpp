@@ -0,0 +1,161 @@
+/*
+ * spi_report.cpp
+ * estimated SPI bus time per OXRS_LCD call under input churn
+ *
+ * boots a layout, then polls every MCP found with random pin changes the way
+ * the firmware does (process() per MCP, loop() per poll) and reports the bus
+ * time spent per API call and per TFT primitive
+ *
+ *   spi_report [-l port_layout] [-m mcps_found] [-n polls] [-c changes] [-p poll_ms]
+ *              [-S] [-B budget_us] [-f spi_hz] [-t transaction_us] [-d command_us] [-r seed]
+ *
+ *   -l   PORT_LAYOUT_... value (default 1128, PORT_LAYOUT_INPUT_128)
+ *   -m   bitmask of MCPs found (default 0xff)
+ *   -n   number of polls (default 1000)
+ *   -c   pins toggled per MCP per poll (default 4)
+ *   -p   virtual time between polls in ms (default 10)
+ *   -S   configure every pin as PIN_TYPE_SECURITY
+ *   -B   setRenderBudget(budget_us), the clock runs on by the bus time so the
+ *        pin changes beyond it are left to the next loop() (-c 16 for a storm)
+ *   -f -t -d  override the bus timing (SCLK Hz, us per transaction, us per command)
+ *   -r   random seed (default 1)
+ */
+
+#include "host_rig.h"
+#include "spi_cost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static uint16_t churn_mask(int changes)
+{
+  uint16_t mask = 0;
+  for (int i = 0; i < changes; i++)
+  {
+    mask |= 1 << (rng() % 16);
+  }
+  return mask;
+}
+
+int main(int argc, char ** argv)
+{
+  int port_layout = PORT_LAYOUT_INPUT_128;
+  int mcps_found = 0xff;
+  int polls = 1000;
+  int changes = 4;
+  int poll_ms = 10;
+  bool security = false;
+  uint32_t budget_us = 0;
+  spi_timing timing = spiTimingDefault();
+  int opt;
+
+  while ((opt = getopt(argc, argv, "l:m:n:c:p:SB:f:t:d:r:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'l': port_layout = strtol(optarg, NULL, 0); break;
+      case 'm': mcps_found = strtol(optarg, NULL, 0); break;
+      case 'n': polls = atoi(optarg); break;
+      case 'c': changes = atoi(optarg); break;
+      case 'p': poll_ms = atoi(optarg); break;
+      case 'S': security = true; break;
+      case 'B': budget_us = strtoul(optarg, NULL, 0); break;
+      case 'f': timing.spi_hz = strtoul(optarg, NULL, 0); break;
+      case 't': timing.transaction_us = atof(optarg); break;
+      case 'd': timing.command_us = atof(optarg); break;
+      case 'r': rng_state = strtoul(optarg, NULL, 0) | 1; break;
+      default:
+        fprintf(stderr, "usage: %s [-l port_layout] [-m mcps_found] [-n polls] [-c changes] [-p poll_ms] [-S] [-B budget_us] [-f spi_hz] [-t transaction_us] [-d command_us] [-r seed]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  host_rig rig;
+  TFT_eSPI * tft = rig.tft();
+  OXRS_LCD& lcd = rig.lcd;
+  spi_meter meter(tft, timing);
+  tft->hostRecord(false);
+
+  // boot, as the firmware does it
+  meter.measure("begin()", [&] { lcd.begin(); });
+  meter.measure("drawHeader()", [&] { lcd.drawHeader("host", "OXRS", "0.0.0", "linux"); });
+  meter.measure("drawPorts()", [&] { lcd.drawPorts(port_layout, mcps_found); });
+  rig.linkUp();
+  meter.measure("loop() link up", [&] { lcd.loop(); });
+
+  if (security)
+  {
+    for (int mcp = 0; mcp < 8; mcp++)
+    {
+      for (int pin = 0; pin < 16; pin++)
+      {
+        meter.measure("setPinType()", [&] { lcd.setPinType(mcp, pin, PIN_TYPE_SECURITY); });
+      }
+    }
+  }
+
+  uint16_t io_values[8];
+  for (int mcp = 0; mcp < 8; mcp++)
+  {
+    io_values[mcp] = 0xffff;
+    meter.measure("process() initial", [&] { lcd.process(mcp, io_values[mcp]); });
+  }
+
+  if (budget_us)
+  {
+    lcd.setRenderBudget(budget_us);
+    spiBusClock(tft, timing);
+  }
+
+  // churn
+  meter.report(stdout);
+  printf("\n");
+  meter.reset();
+  tft->hostBusReset();
+
+  for (int poll = 0; poll < polls; poll++)
+  {
+    hostClockAdvanceMs(poll_ms);
+    for (int mcp = 0; mcp < 8; mcp++)
+    {
+      if (!bitRead(mcps_found, mcp)) continue;
+      io_values[mcp] ^= churn_mask(changes);
+      meter.measure("process()", [&] { lcd.process(mcp, io_values[mcp]); });
+    }
+    if ((poll % 100) == 0)
+    {
+      meter.measure("showEvent()", [&] { lcd.showEvent("IN:042 PRESS"); });
+      meter.measure("triggerMqttTxLed()", [&] { lcd.triggerMqttTxLed(); });
+    }
+    meter.measure("loop()", [&] { lcd.loop(); });
+  }
+
+  if (budget_us) printf("%d LEDs left to the next poll\n", lcd.getPendingRepaints());
+
+  double elapsed_us = (double)polls * poll_ms * 1000;
+  meter.report(stdout);
+  printf("\nbus busy %.1f ms of %.1f ms (%.1f %%) at %.1f MHz\n\n",
+    meter.totalMicros() / 1000, elapsed_us / 1000,
+    100.0 * meter.totalMicros() / elapsed_us, timing.spi_hz / 1e6);
+
+  printf("%-16s %11s %11s %9s %9s\n", "primitive", "total ms", "bytes", "windows", "cs");
+  for (int kind = 0; kind < TFT_OP_KIND_COUNT; kind++)
+  {
+    const tft_bus_stats& bus = tft->hostBusStats((tft_op_kind)kind);
+    if (!bus.commands && !bus.pixel_bytes) continue;
+    printf("%-16s %11.2f %11u %9u %9u\n", tftOpName((tft_op_kind)kind),
+      spiBusMicros(bus, timing) / 1000, spiBusBytes(bus), bus.windows, bus.transactions * 2);
+  }
+  return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Arduino.cpp
+ * host stand-in for the ESP32 Arduino core
+ *
+ */
+
+#include "Arduino.h"
+#include "LittleFS.h"
+
+#include <string>
+#include <thread>
+
+static uint64_t _clock_us = 0;
+static uint64_t (*_clock_source)(void) = NULL;
+static uint64_t (*_clock_busy)(void) = NULL;
+static uint32_t _ledc_duty[16];
+
+/*
+ * virtual clock
+ */
+uint64_t hostClockMicros(void)
+{
+  uint64_t us = _clock_source ? _clock_source() : _clock_us;
+  return _clock_busy ? us + _clock_busy() : us;
+}
+
+void hostClockSet(uint64_t us)
+{
+  _clock_us = us;
+}
+
+void hostClockAdvance(uint64_t us)
+{
+  _clock_us += us;
+}
+
+void hostClockAdvanceMs(uint32_t ms)
+{
+  _clock_us += (uint64_t)ms * 1000;
+}
+
+void hostClockSource(uint64_t (*source)(void))
+{
+  _clock_source = source;
+}
+
+void hostClockBusy(uint64_t (*busy)(void))
+{
+  _clock_busy = busy;
+}
+
+unsigned long millis(void)
+{
+  return (unsigned long)(uint32_t)(hostClockMicros() / 1000);
+}
+
+unsigned long micros(void)
+{
+  return (unsigned long)(uint32_t)hostClockMicros();
+}
+
+void delay(uint32_t ms)
+{
+  if (!_clock_source) hostClockAdvanceMs(ms);
+}
+
+// to the other threads, the clock stays
+void yield(void)
+{
+  std::this_thread::yield();
+}
+
+/*
+ * backlight PWM
+ */
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits)
+{
+  return freq;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel)
+{
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty)
+{
+  if (channel < 16) _ledc_duty[channel] = duty;
+}
+
+uint32_t hostLedcDuty(uint8_t channel)
+{
+  return (channel < 16) ? _ledc_duty[channel] : 0;
+}
+
+/*
+ * LittleFS backed by a host directory
+ */
+LittleFSFS LittleFS;
+
+size_t File::size(void)
+{
+  if (!_f) return 0;
+
+  long pos = ftell(_f.get());
+  fseek(_f.get(), 0, SEEK_END);
+  long size = ftell(_f.get());
+  fseek(_f.get(), pos, SEEK_SET);
+  return (size_t)size;
+}
+
+int File::read(void)
+{
+  return _f ? fgetc(_f.get()) : -1;
+}
+
+size_t File::read(uint8_t * buf, size_t size)
+{
+  return _f ? fread(buf, 1, size, _f.get()) : 0;
+}
+
+bool File::seek(uint32_t pos)
+{
+  return _f && fseek(_f.get(), pos, SEEK_SET) == 0;
+}
+
+size_t File::write(uint8_t c)
+{
+  return (_f && fputc(c, _f.get()) != EOF) ? 1 : 0;
+}
+
+size_t File::write(const uint8_t * buf, size_t size)
+{
+  return _f ? fwrite(buf, 1, size, _f.get()) : 0;
+}
+
+bool LittleFSFS::begin(bool formatOnFail)
+{
+  return !_root.empty();
+}
+
+File LittleFSFS::open(const char * path, const char * mode)
+{
+  if (_root.empty()) return File();
+
+  std::string full = _root + path;
+  FILE * f = fopen(full.c_str(), (mode[0] == 'r') ? "rb" : "wb");
+  return f ? File(f) : File();
+}
+
+void LittleFSFS::hostSetRoot(const char * dir)
+{
+  _root = dir ? dir : "";
+}
@@ -0,0 +1,65 @@
+/*
+ * Arduino.h
+ * host stand-in for the ESP32 Arduino core, just enough to build OXRS_LCD on Linux
+ *
+ * time is virtual: millis() and micros() only move when the host advances the clock
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "binary.h"
+#include "pgmspace.h"
+#include "IPAddress.h"
+#include "Print.h"
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define bitRead(value, bit)             (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)              ((value) |= (1UL << (bit)))
+#define bitClear(value, bit)            ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue)  ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(uint32_t ms);
+void yield(void);
+
+// backlight PWM
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+/*
+ * host only: virtual clock
+ *
+ * the clock starts at 0 and only moves when told to, so every run is repeatable.
+ * hostClockSource() injects an external time source (in micro seconds) instead,
+ * pass NULL to go back to the virtual clock.
+ */
+void     hostClockSet(uint64_t us);
+void     hostClockAdvance(uint64_t us);
+void     hostClockAdvanceMs(uint32_t ms);
+uint64_t hostClockMicros(void);
+void     hostClockSource(uint64_t (*source)(void));
+
+/*
+ * host only: device busy time
+ *
+ * the virtual clock stands still while the library draws. a busy source (in
+ * micro seconds, never decreasing) is added to the clock so micros() moves
+ * across a draw as it would on the board, pass NULL to remove it.
+ */
+void     hostClockBusy(uint64_t (*busy)(void));
+
+// host only: last duty written to a ledc channel
+uint32_t hostLedcDuty(uint8_t channel);
+
+#endif
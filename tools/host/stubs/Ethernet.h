@@ -0,0 +1,38 @@
+/*
+ * Ethernet.h
+ * host stand-in for the Arduino Ethernet library
+ *
+ * link state, IP and MAC are set by the host via the host...() members
+ */
+
+#ifndef ethernet_h_
+#define ethernet_h_
+
+#include <Arduino.h>
+
+enum EthernetLinkStatus
+{
+  Unknown,
+  LinkON,
+  LinkOFF
+};
+
+class EthernetClass
+{
+  public:
+    void MACAddress(uint8_t * mac_address) { memcpy(mac_address, _mac, 6); }
+    IPAddress localIP(void) { return _ip; }
+    EthernetLinkStatus linkStatus(void) { return _link; }
+
+    // host only
+    void hostSetLink(EthernetLinkStatus link) { _link = link; }
+    void hostSetIP(IPAddress ip) { _ip = ip; }
+    void hostSetMAC(const uint8_t * mac) { memcpy(_mac, mac, 6); }
+
+  private:
+    EthernetLinkStatus _link = LinkOFF;
+    IPAddress _ip;
+    uint8_t _mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+};
+
+#endif
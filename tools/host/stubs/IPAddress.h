@@ -0,0 +1,29 @@
+/*
+ * IPAddress.h
+ * host stand-in for the Arduino core IPAddress
+ */
+
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <stdint.h>
+
+class IPAddress
+{
+  public:
+    IPAddress() : _address{0, 0, 0, 0} {}
+    IPAddress(uint8_t o1, uint8_t o2, uint8_t o3, uint8_t o4) : _address{o1, o2, o3, o4} {}
+
+    uint8_t operator[](int index) const { return _address[index]; }
+    uint8_t& operator[](int index) { return _address[index]; }
+
+    bool operator==(const IPAddress& addr) const
+    {
+      return _address[0] == addr[0] && _address[1] == addr[1] && _address[2] == addr[2] && _address[3] == addr[3];
+    }
+
+  private:
+    uint8_t _address[4];
+};
+
+#endif
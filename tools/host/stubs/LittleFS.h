@@ -0,0 +1,51 @@
+/*
+ * LittleFS.h
+ * host stand-in for the ESP32 LittleFS library
+ *
+ * the file system is a plain host directory, set with LittleFS.hostSetRoot().
+ * without a root begin() fails, as on a board with an unformatted partition.
+ */
+
+#ifndef _LITTLEFS_H_
+#define _LITTLEFS_H_
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+class File : public Print
+{
+  public:
+    File() {}
+    explicit File(FILE * f) : _f(f, fclose) {}
+
+    operator bool() const { return (bool)_f; }
+
+    size_t size(void);
+    int read(void);
+    size_t read(uint8_t * buf, size_t size);
+    bool seek(uint32_t pos);
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t * buf, size_t size) override;
+    void close(void) { _f.reset(); }
+
+  private:
+    std::shared_ptr<FILE> _f;
+};
+
+class LittleFSFS
+{
+  public:
+    bool begin(bool formatOnFail = false);
+    File open(const char * path, const char * mode = "r");
+
+    // host only
+    void hostSetRoot(const char * dir);
+
+  private:
+    std::string _root;
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * OXRS_MQTT.h
+ * host stand-in for the OXRS MQTT library, only what OXRS_LCD uses
+ */
+
+#ifndef OXRS_MQTT_H
+#define OXRS_MQTT_H
+
+#include <Arduino.h>
+
+class OXRS_MQTT
+{
+  public:
+    int connected(void) { return _connected; }
+
+    char * getWildcardTopic(char topic[])
+    {
+      strcpy(topic, _topic);
+      return topic;
+    }
+
+    // host only
+    void hostSetConnected(bool connected) { _connected = connected; }
+    void hostSetTopic(const char * topic)
+    {
+      strncpy(_topic, topic, sizeof(_topic) - 1);
+      _topic[sizeof(_topic) - 1] = 0;
+    }
+
+  private:
+    bool _connected = false;
+    char _topic[64] = "host/+/#";
+};
+
+#endif
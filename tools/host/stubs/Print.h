@@ -0,0 +1,30 @@
+/*
+ * Print.h
+ * host stand-in for the Arduino Print interface (byte sink of Serial, File, ...)
+ */
+
+#ifndef Print_h
+#define Print_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t * buffer, size_t size)
+    {
+      size_t n = 0;
+      while (size--)
+      {
+        if (!write(*buffer++)) break;
+        n++;
+      }
+      return n;
+    }
+};
+
+#endif
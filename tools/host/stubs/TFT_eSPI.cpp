@@ -0,0 +1,691 @@
+/*
+ * TFT_eSPI.cpp
+ * host stand-in for Bodmer's TFT_eSPI
+ *
+ * the public primitives record themselves and are then broken down exactly
+ * like TFT_eSPI 2.x does for an SPI connected ST7789, down to the bus layer
+ * (begin/end_tft_write, setWindow, pushBlock, pushPixels) which counts traffic
+ */
+
+#include "TFT_eSPI.h"
+
+// the GFX free fonts ship with TFT_eSPI, not with this library, so the host
+// build substitutes the Roboto fonts of similar size for FMB9 and FSSB9
+#include <roboto_fonts.h>
+
+const GFXfont FreeMonoBold9pt7b = Roboto_Mono_Thin_13;
+const GFXfont FreeSansBold9pt7b = Roboto_Light_13;
+
+static const char * op_names[TFT_OP_KIND_COUNT] =
+{
+  "fillRect", "drawRect", "fillRoundRect", "drawString", "pushImage", "drawBitmap", "setAddrWindow", "pushPixels"
+};
+
+const char * tftOpName(tft_op_kind kind)
+{
+  return (kind < TFT_OP_KIND_COUNT) ? op_names[kind] : "?";
+}
+
+tft_bus_stats tftBusDelta(const tft_bus_stats& after, const tft_bus_stats& before)
+{
+  tft_bus_stats delta;
+  delta.transactions = after.transactions - before.transactions;
+  delta.windows = after.windows - before.windows;
+  delta.commands = after.commands - before.commands;
+  delta.param_bytes = after.param_bytes - before.param_bytes;
+  delta.pixel_bytes = after.pixel_bytes - before.pixel_bytes;
+  return delta;
+}
+
+static void bus_add(tft_bus_stats& sum, const tft_bus_stats& delta)
+{
+  sum.transactions += delta.transactions;
+  sum.windows += delta.windows;
+  sum.commands += delta.commands;
+  sum.param_bytes += delta.param_bytes;
+  sum.pixel_bytes += delta.pixel_bytes;
+}
+
+TFT_eSPI::TFT_eSPI(int16_t w, int16_t h)
+{
+  _init_width = _width = w;
+  _init_height = _height = h;
+}
+
+void TFT_eSPI::init(uint8_t tc)
+{
+  _rotation = 0;
+  _width = _init_width;
+  _height = _init_height;
+}
+
+void TFT_eSPI::begin(uint8_t tc)
+{
+  init(tc);
+}
+
+void TFT_eSPI::setRotation(uint8_t r)
+{
+  _rotation = r % 4;
+  _width = (_rotation & 1) ? _init_height : _init_width;
+  _height = (_rotation & 1) ? _init_width : _init_height;
+  _addr_row = _addr_col = -1;
+}
+
+uint8_t TFT_eSPI::getRotation(void)
+{
+  return _rotation;
+}
+
+int16_t TFT_eSPI::width(void)
+{
+  return _width;
+}
+
+int16_t TFT_eSPI::height(void)
+{
+  return _height;
+}
+
+void TFT_eSPI::startWrite(void)
+{
+  _begin_tft_write();
+  _lockTransaction = true;
+  _inTransaction = true;
+}
+
+void TFT_eSPI::endWrite(void)
+{
+  _lockTransaction = false;
+  _inTransaction = false;
+  _end_tft_write();
+}
+
+void TFT_eSPI::fillScreen(uint32_t color)
+{
+  fillRect(0, 0, _width, _height, color);
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  tft_bus_stats before = _bus;
+  _record(TFT_OP_FILL_RECT, x, y, w, h, 0, color, 0);
+  _fillRect(x, y, w, h, color);
+  _account(TFT_OP_FILL_RECT, before);
+}
+
+void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  tft_bus_stats before = _bus;
+  _record(TFT_OP_DRAW_RECT, x, y, w, h, 0, color, 0);
+
+  _inTransaction = true;
+  _drawFastHLine(x, y, w, color);
+  _drawFastHLine(x, y + h - 1, w, color);
+  // Avoid drawing corner pixels twice
+  _drawFastVLine(x, y + 1, h - 2, color);
+  _drawFastVLine(x + w - 1, y + 1, h - 2, color);
+  _inTransaction = _lockTransaction;
+  _end_tft_write();
+  _account(TFT_OP_DRAW_RECT, before);
+}
+
+void TFT_eSPI::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
+{
+  tft_bus_stats before = _bus;
+  _record(TFT_OP_FILL_ROUND_RECT, x, y, w, h, r, color, 0);
+
+  _inTransaction = true;
+  _fillRect(x, y + r, w, h - r - r, color);
+  // draw four corners
+  _fillCircleHelper(x + r, y + h - r - 1, r, 1, w - r - r - 1, color);
+  _fillCircleHelper(x + r, y + r, r, 2, w - r - r - 1, color);
+  _inTransaction = _lockTransaction;
+  _end_tft_write();
+  _account(TFT_OP_FILL_ROUND_RECT, before);
+}
+
+void TFT_eSPI::drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t fgcolor, uint16_t bgcolor)
+{
+  tft_bus_stats before = _bus;
+  _record(TFT_OP_DRAW_BITMAP, x, y, w, h, 0, fgcolor, bgcolor);
+
+  _inTransaction = true;
+  int32_t byteWidth = (w + 7) / 8;
+  for (int32_t j = 0; j < h; j++)
+  {
+    for (int32_t i = 0; i < w; i++)
+    {
+      if (pgm_read_byte(bitmap + j * byteWidth + i / 8) & (128 >> (i & 7)))
+        _drawPixel(x + i, y + j, fgcolor);
+      else
+        _drawPixel(x + i, y + j, bgcolor);
+    }
+  }
+  _inTransaction = _lockTransaction;
+  _end_tft_write();
+  _account(TFT_OP_DRAW_BITMAP, before);
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data)
+{
+  tft_bus_stats before = _bus;
+  _record(TFT_OP_PUSH_IMAGE, x, y, w, h, 0, 0, 0);
+  _pushImage(x, y, w, h, data);
+  _account(TFT_OP_PUSH_IMAGE, before);
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+{
+  pushImage(x, y, w, h, (uint16_t *)data);
+}
+
+// the window is not clipped, as in TFT_eSPI
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  tft_bus_stats before = _bus;
+  _record(TFT_OP_SET_ADDR_WINDOW, x, y, w, h, 0, 0, 0);
+  _begin_tft_write();
+  _setWindow(x, y, x + w - 1, y + h - 1);
+  _end_tft_write();
+  _account(TFT_OP_SET_ADDR_WINDOW, before);
+}
+
+// into the window of the last setAddrWindow() (or primitive), honours setSwapBytes().
+// counted with the bus traffic of its kind, not recorded: the window is the primitive
+void TFT_eSPI::pushPixels(const void *data_in, uint32_t len)
+{
+  tft_bus_stats before = _bus;
+  _begin_tft_write();
+  _pushPixels((const uint16_t *)data_in, len);
+  _end_tft_write();
+  _account(TFT_OP_PUSH_PIXELS, before);
+}
+
+void TFT_eSPI::setSwapBytes(bool swap)
+{
+  _swapBytes = swap;
+}
+
+bool TFT_eSPI::getSwapBytes(void)
+{
+  return _swapBytes;
+}
+
+void TFT_eSPI::setTextColor(uint16_t color)
+{
+  _textcolor = _textbgcolor = color;
+}
+
+void TFT_eSPI::setTextColor(uint16_t fgcolor, uint16_t bgcolor, bool bgfill)
+{
+  _textcolor = fgcolor;
+  _textbgcolor = bgcolor;
+}
+
+void TFT_eSPI::setTextDatum(uint8_t datum)
+{
+  _textdatum = datum;
+}
+
+uint8_t TFT_eSPI::getTextDatum(void)
+{
+  return _textdatum;
+}
+
+void TFT_eSPI::setFreeFont(const GFXfont *f)
+{
+  _gfxFont = f;
+  _glyph_ab = 0;
+  _glyph_bb = 0;
+  if (!f) return;
+
+  // Find the biggest above and below baseline offsets
+  uint16_t numChars = f->last - f->first;
+  for (uint16_t c = 0; c < numChars; c++)
+  {
+    const GFXglyph *glyph = &f->glyph[c];
+    int8_t ab = -glyph->yOffset;
+    if (ab > _glyph_ab) _glyph_ab = ab;
+    int8_t bb = glyph->height - ab;
+    if (bb > _glyph_bb) _glyph_bb = bb;
+  }
+}
+
+int16_t TFT_eSPI::drawString(const char *string, int32_t poX, int32_t poY)
+{
+  int16_t cwidth = textWidth(string);
+  int16_t cheight = 8;
+  int16_t baseline = 0;
+
+  tft_bus_stats before = _bus;
+  _record(TFT_OP_DRAW_STRING, poX, poY, cwidth, _gfxFont ? _glyph_ab + _glyph_bb : 8, _textdatum, _textcolor, _textbgcolor, string);
+
+  // the GLCD font is not rendered by the stand-in
+  if (!_gfxFont) return cwidth;
+
+  cheight = _glyph_ab;
+  poY += cheight;          // Adjust for baseline datum of free fonts
+  baseline = cheight;
+
+  switch (_textdatum)
+  {
+    case TC_DATUM:   poX -= cwidth / 2; break;
+    case TR_DATUM:   poX -= cwidth; break;
+    case ML_DATUM:   poY -= cheight / 2; break;
+    case MC_DATUM:   poX -= cwidth / 2; poY -= cheight / 2; break;
+    case MR_DATUM:   poX -= cwidth; poY -= cheight / 2; break;
+    case BL_DATUM:   poY -= cheight; break;
+    case BC_DATUM:   poX -= cwidth / 2; poY -= cheight; break;
+    case BR_DATUM:   poX -= cwidth; poY -= cheight; break;
+    case L_BASELINE: poY -= baseline; break;
+    case C_BASELINE: poX -= cwidth / 2; poY -= baseline; break;
+    case R_BASELINE: poX -= cwidth; poY -= baseline; break;
+  }
+
+  // free fonts with a background colour get a filled box behind the text
+  if (_textcolor != _textbgcolor && string[0])
+  {
+    uint8_t c = string[0];
+    if (c >= _gfxFont->first && c <= _gfxFont->last)
+    {
+      int8_t xo = _gfxFont->glyph[c - _gfxFont->first].xOffset;
+      if (xo > 0) xo = 0;
+      else cwidth -= xo;
+      _fillRect(poX + xo, poY - _glyph_ab, cwidth, _glyph_ab + _glyph_bb, _textbgcolor);
+    }
+  }
+
+  int16_t sumX = 0;
+  while (*string)
+  {
+    sumX += _drawChar((uint8_t)*string++, poX + sumX, poY);
+  }
+  _account(TFT_OP_DRAW_STRING, before);
+  return sumX;
+}
+
+int16_t TFT_eSPI::textWidth(const char *string)
+{
+  int16_t w = 0;
+
+  while (*string)
+  {
+    uint8_t c = *string++;
+    if (!_gfxFont)
+    {
+      w += 6;
+    }
+    else if (c >= _gfxFont->first && c <= _gfxFont->last)
+    {
+      const GFXglyph *glyph = &_gfxFont->glyph[c - _gfxFont->first];
+      // If this is not the last character then use xAdvance,
+      // else use the offset plus width since this can be bigger than xAdvance
+      if (*string) w += glyph->xAdvance;
+      else w += glyph->xOffset + glyph->width;
+    }
+  }
+  return w;
+}
+
+uint16_t TFT_eSPI::color565(uint8_t r, uint8_t g, uint8_t b)
+{
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+size_t TFT_eSPI::hostOpCount(tft_op_kind kind) const
+{
+  size_t count = 0;
+  for (const tft_op& op : _ops)
+  {
+    if (op.kind == kind) count++;
+  }
+  return count;
+}
+
+void TFT_eSPI::_account(tft_op_kind kind, const tft_bus_stats& before)
+{
+  bus_add(_bus_kind[kind], tftBusDelta(_bus, before));
+}
+
+void TFT_eSPI::_record(tft_op_kind kind, int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color, uint32_t bg, const char *text)
+{
+  if (!_recording) return;
+
+  tft_op op;
+  op.kind = kind;
+  op.x = x;
+  op.y = y;
+  op.w = w;
+  op.h = h;
+  op.r = r;
+  op.color = color;
+  op.bg = bg;
+  if (text) op.text = text;
+  _ops.push_back(op);
+}
+
+/*
+ * TFT_eSPI internals
+ */
+void TFT_eSPI::_pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data)
+{
+  if ((x >= _width) || (y >= _height)) return;
+
+  int32_t dx = 0;
+  int32_t dy = 0;
+  int32_t dw = w;
+  int32_t dh = h;
+
+  if (x < 0) { dw += x; dx = -x; x = 0; }
+  if (y < 0) { dh += y; dy = -y; y = 0; }
+  if ((x + dw) > _width) dw = _width - x;
+  if ((y + dh) > _height) dh = _height - y;
+  if (dw < 1 || dh < 1) return;
+
+  _begin_tft_write();
+  _inTransaction = true;
+
+  _setWindow(x, y, x + dw - 1, y + dh - 1);
+  data += dx + dy * w;
+  if (dw == w)
+  {
+    _pushPixels(data, dw * dh);
+  }
+  else
+  {
+    while (dh--)
+    {
+      _pushPixels(data, dw);
+      data += w;
+    }
+  }
+
+  _inTransaction = _lockTransaction;
+  _end_tft_write();
+}
+
+void TFT_eSPI::_fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+  if ((x >= _width) || (y >= _height)) return;
+
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if ((x + w) > _width)  w = _width  - x;
+  if ((y + h) > _height) h = _height - y;
+  if ((w < 1) || (h < 1)) return;
+
+  _begin_tft_write();
+  _setWindow(x, y, x + w - 1, y + h - 1);
+  _pushBlock(color, w * h);
+  _end_tft_write();
+}
+
+void TFT_eSPI::_drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
+{
+  if ((y < 0) || (x >= _width) || (y >= _height)) return;
+
+  if (x < 0) { w += x; x = 0; }
+  if ((x + w) > _width) w = _width - x;
+  if (w < 1) return;
+
+  _begin_tft_write();
+  _setWindow(x, y, x + w - 1, y);
+  _pushBlock(color, w);
+  _end_tft_write();
+}
+
+void TFT_eSPI::_drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
+{
+  if ((x < 0) || (x >= _width) || (y >= _height)) return;
+
+  if (y < 0) { h += y; y = 0; }
+  if ((y + h) > _height) h = _height - y;
+  if (h < 1) return;
+
+  _begin_tft_write();
+  _setWindow(x, y, x, y + h - 1);
+  _pushBlock(color, h);
+  _end_tft_write();
+}
+
+// drawPixel skips CASET / RASET when the column / row did not change
+void TFT_eSPI::_drawPixel(int32_t x, int32_t y, uint32_t color)
+{
+  if ((x < 0) || (y < 0) || (x >= _width) || (y >= _height)) return;
+
+  _begin_tft_write();
+  if (_addr_col != x)
+  {
+    _bus.commands++;
+    _bus.param_bytes += 4;
+    _addr_col = x;
+  }
+  if (_addr_row != y)
+  {
+    _bus.commands++;
+    _bus.param_bytes += 4;
+    _addr_row = y;
+  }
+  _bus.commands++;
+  _bus.pixel_bytes += 2;
+  if (!_fb.empty()) _fb[y * _width + x] = color;
+  _end_tft_write();
+}
+
+void TFT_eSPI::_fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t cornername, int32_t delta, uint32_t color)
+{
+  if (r <= 0) return;
+
+  int32_t f     = 1 - r;
+  int32_t ddF_x = 1;
+  int32_t ddF_y = -r - r;
+  int32_t y     = 0;
+
+  delta++;
+
+  while (y < r)
+  {
+    if (f >= 0)
+    {
+      if (cornername & 0x1) _drawFastHLine(x0 - y, y0 + r, y + y + delta, color);
+      if (cornername & 0x2) _drawFastHLine(x0 - y, y0 - r, y + y + delta, color);
+      r--;
+      ddF_y += 2;
+      f     += ddF_y;
+    }
+
+    y++;
+    ddF_x += 2;
+    f     += ddF_x;
+
+    if (cornername & 0x1) _drawFastHLine(x0 - r, y0 + y, r + r + delta, color);
+    if (cornername & 0x2) _drawFastHLine(x0 - r, y0 - y, r + r + delta, color);
+  }
+}
+
+// free font glyph, foreground pixels only, as horizontal runs
+int16_t TFT_eSPI::_drawChar(uint16_t c, int32_t x, int32_t y)
+{
+  if (c < _gfxFont->first || c > _gfxFont->last) return 0;
+
+  const GFXglyph *glyph = &_gfxFont->glyph[c - _gfxFont->first];
+  const uint8_t  *bitmap = _gfxFont->bitmap;
+  uint32_t bo = glyph->bitmapOffset;
+  uint8_t  w = glyph->width, h = glyph->height;
+  int8_t   xo = glyph->xOffset, yo = glyph->yOffset;
+  uint8_t  xx, yy, bits = 0, bit = 0;
+  uint16_t hpc = 0;
+
+  _inTransaction = true;
+  for (yy = 0; yy < h; yy++)
+  {
+    for (xx = 0; xx < w; xx++)
+    {
+      if (bit == 0)
+      {
+        bits = pgm_read_byte(&bitmap[bo++]);
+        bit  = 0x80;
+      }
+      if (bits & bit)
+      {
+        hpc++;
+      }
+      else if (hpc)
+      {
+        _drawFastHLine(x + xo + xx - hpc, y + yo + yy, hpc, _textcolor);
+        hpc = 0;
+      }
+      bit >>= 1;
+    }
+    if (hpc)
+    {
+      _drawFastHLine(x + xo + xx - hpc, y + yo + yy, hpc, _textcolor);
+      hpc = 0;
+    }
+  }
+  _inTransaction = _lockTransaction;
+  _end_tft_write();
+
+  return glyph->xAdvance;
+}
+
+/*
+ * bus layer
+ */
+void TFT_eSPI::_begin_tft_write(void)
+{
+  if (_locked)
+  {
+    _locked = false;
+    _bus.transactions++;
+  }
+}
+
+void TFT_eSPI::_end_tft_write(void)
+{
+  if (!_inTransaction && !_locked)
+  {
+    _locked = true;
+  }
+}
+
+void TFT_eSPI::_setWindow(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+  _bus.windows++;
+  _bus.commands += 3;         // CASET, PASET, RAMWR
+  _bus.param_bytes += 8;
+  _addr_row = _addr_col = -1;
+
+  _win_x0 = _win_x = x0;
+  _win_y0 = _win_y = y0;
+  _win_x1 = x1;
+  _win_y1 = y1;
+}
+
+void TFT_eSPI::_pushBlock(uint16_t color, uint32_t len)
+{
+  _bus.pixel_bytes += len * 2;
+
+  if (_fb.empty()) return;
+  while (len--) _fbWrite(color);
+}
+
+// without swapBytes the data goes out in memory order, i.e. low byte first
+void TFT_eSPI::_pushPixels(const uint16_t *data, uint32_t len)
+{
+  _bus.pixel_bytes += len * 2;
+
+  if (_fb.empty()) return;
+  while (len--)
+  {
+    uint16_t color = *data++;
+    _fbWrite(_swapBytes ? color : (uint16_t)((color >> 8) | (color << 8)));
+  }
+}
+
+// RAMWR: next pixel of the address window, row by row, wrapping to its start
+void TFT_eSPI::_fbWrite(uint16_t color)
+{
+  if (_win_x >= 0 && _win_y >= 0 && _win_x < _width && _win_y < _height)
+  {
+    _fb[_win_y * _width + _win_x] = color;
+  }
+  if (++_win_x > _win_x1)
+  {
+    _win_x = _win_x0;
+    if (++_win_y > _win_y1) _win_y = _win_y0;
+  }
+}
+
+/*
+ * host only: framebuffer
+ */
+void TFT_eSPI::hostFramebuffer(bool on)
+{
+  _fb.assign(on ? (size_t)_init_width * _init_height : 0, TFT_BLACK);
+}
+
+uint16_t TFT_eSPI::hostPixel(int32_t x, int32_t y) const
+{
+  if (_fb.empty() || x < 0 || y < 0 || x >= _width || y >= _height) return 0;
+  return _fb[y * _width + x];
+}
+
+void TFT_eSPI::hostMask(int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  tft_rect mask = {x, y, w, h};
+  _masks.push_back(mask);
+}
+
+uint16_t TFT_eSPI::_fbRead(size_t index) const
+{
+  int32_t x = index % _width;
+  int32_t y = index / _width;
+  for (const tft_rect& mask : _masks)
+  {
+    if (x >= mask.x && y >= mask.y && x < mask.x + mask.w && y < mask.y + mask.h) return TFT_BLACK;
+  }
+  return _fb[index];
+}
+
+// CRC-32 (IEEE) over the pixels, row by row, low byte first
+uint32_t TFT_eSPI::hostFramebufferCrc(void) const
+{
+  uint32_t crc = 0xffffffff;
+  for (size_t index = 0; index < _fb.size(); index++)
+  {
+    uint16_t pixel = _fbRead(index);
+    uint8_t bytes[2] = {(uint8_t)(pixel & 0xff), (uint8_t)(pixel >> 8)};
+    for (uint8_t byte : bytes)
+    {
+      crc ^= byte;
+      for (int bit = 0; bit < 8; bit++)
+      {
+        crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+      }
+    }
+  }
+  return ~crc;
+}
+
+// binary PPM (P6), RGB565 expanded to 8 bits per channel
+bool TFT_eSPI::hostWritePPM(const char *path) const
+{
+  if (_fb.empty()) return false;
+
+  FILE * f = fopen(path, "wb");
+  if (!f) return false;
+
+  fprintf(f, "P6\n%d %d\n255\n", _width, _height);
+  for (size_t index = 0; index < _fb.size(); index++)
+  {
+    uint16_t pixel = _fbRead(index);
+    uint8_t r = (pixel >> 11) & 0x1f;
+    uint8_t g = (pixel >> 5) & 0x3f;
+    uint8_t b = pixel & 0x1f;
+    uint8_t rgb[3] = {(uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)), (uint8_t)((b << 3) | (b >> 2))};
+    fwrite(rgb, 1, 3, f);
+  }
+  return fclose(f) == 0;
+}
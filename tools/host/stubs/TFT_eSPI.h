@@ -0,0 +1,243 @@
+/*
+ * TFT_eSPI.h
+ * host stand-in for Bodmer's TFT_eSPI, recording every primitive OXRS_LCD draws
+ *
+ * the display setup is taken from UserSetup/Setup000_RACK32_ST7789.h so the
+ * host build sees the same TFT_* pins, size and SPI frequency as the RACK32
+ */
+
+#ifndef _TFT_eSPIH_
+#define _TFT_eSPIH_
+
+#include <Arduino.h>
+#include <Setup000_RACK32_ST7789.h>
+
+#include <string>
+#include <vector>
+
+// colours, as defined by TFT_eSPI (RGB565)
+#define TFT_BLACK       0x0000
+#define TFT_NAVY        0x000F
+#define TFT_DARKGREEN   0x03E0
+#define TFT_DARKCYAN    0x03EF
+#define TFT_MAROON      0x7800
+#define TFT_PURPLE      0x780F
+#define TFT_OLIVE       0x7BE0
+#define TFT_LIGHTGREY   0xD69A
+#define TFT_DARKGREY    0x7BEF
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK        0xFE19
+#define TFT_BROWN       0x9A60
+#define TFT_GOLD        0xFEA0
+#define TFT_SILVER      0xC618
+#define TFT_SKYBLUE     0x867D
+#define TFT_VIOLET      0x915C
+
+// text datums
+#define TL_DATUM        0
+#define TC_DATUM        1
+#define TR_DATUM        2
+#define ML_DATUM        3
+#define CL_DATUM        3
+#define MC_DATUM        4
+#define CC_DATUM        4
+#define MR_DATUM        5
+#define CR_DATUM        5
+#define BL_DATUM        6
+#define BC_DATUM        7
+#define BR_DATUM        8
+#define L_BASELINE      9
+#define C_BASELINE      10
+#define R_BASELINE      11
+
+// Adafruit GFX font format, as used by TFT_eSPI
+typedef struct
+{
+  uint32_t  bitmapOffset;
+  uint8_t   width, height;
+  uint8_t   xAdvance;
+  int8_t    xOffset, yOffset;
+} GFXglyph;
+
+typedef struct
+{
+  uint8_t  *bitmap;
+  GFXglyph *glyph;
+  uint16_t  first, last;
+  uint8_t   yAdvance;
+} GFXfont;
+
+// free fonts referenced through Free_Fonts.h, stand-in glyphs (see TFT_eSPI.cpp)
+extern const GFXfont FreeMonoBold9pt7b;
+extern const GFXfont FreeSansBold9pt7b;
+
+/*
+ * host only: one recorded draw primitive
+ */
+enum tft_op_kind
+{
+  TFT_OP_FILL_RECT,
+  TFT_OP_DRAW_RECT,
+  TFT_OP_FILL_ROUND_RECT,
+  TFT_OP_DRAW_STRING,
+  TFT_OP_PUSH_IMAGE,
+  TFT_OP_DRAW_BITMAP,
+  TFT_OP_SET_ADDR_WINDOW,
+  TFT_OP_PUSH_PIXELS,
+  TFT_OP_KIND_COUNT
+};
+
+typedef struct
+{
+  tft_op_kind kind;
+  int32_t     x, y, w, h;
+  int32_t     r;              // corner radius (fillRoundRect) or text datum (drawString)
+  uint32_t    color;
+  uint32_t    bg;
+  std::string text;           // drawString only
+} tft_op;
+
+const char * tftOpName(tft_op_kind kind);
+
+typedef struct
+{
+  int32_t     x, y, w, h;
+} tft_rect;
+
+/*
+ * host only: SPI bus traffic, as the ST7789 driver of TFT_eSPI would generate it
+ *
+ * every primitive is broken down the way TFT_eSPI does it (fillRoundRect into
+ * a fillRect and a fan of drawFastHLine, free font glyphs into horizontal runs,
+ * drawBitmap into drawPixel, ...). each address window costs CASET + RASET + RAMWR.
+ */
+typedef struct
+{
+  uint32_t transactions;      // CS low .. CS high, i.e. 2 CS toggles each
+  uint32_t windows;           // setWindow() calls (CASET + RASET + RAMWR)
+  uint32_t commands;          // command bytes, each one a DC toggle
+  uint32_t param_bytes;       // address bytes following CASET / RASET
+  uint32_t pixel_bytes;       // RAMWR data
+} tft_bus_stats;
+
+tft_bus_stats tftBusDelta(const tft_bus_stats& after, const tft_bus_stats& before);
+
+class TFT_eSPI
+{
+  public:
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT);
+
+    void     init(uint8_t tc = 0);
+    void     begin(uint8_t tc = 0);
+    void     setRotation(uint8_t r);
+    uint8_t  getRotation(void);
+    int16_t  width(void);
+    int16_t  height(void);
+
+    void     startWrite(void);
+    void     endWrite(void);
+
+    void     fillScreen(uint32_t color);
+    void     fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void     drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void     fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t radius, uint32_t color);
+    void     drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t fgcolor, uint16_t bgcolor);
+
+    void     pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data);
+    void     pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+    void     setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+    void     pushPixels(const void *data_in, uint32_t len);
+    void     setSwapBytes(bool swap);
+    bool     getSwapBytes(void);
+
+    void     setTextColor(uint16_t color);
+    void     setTextColor(uint16_t fgcolor, uint16_t bgcolor, bool bgfill = false);
+    void     setTextDatum(uint8_t datum);
+    uint8_t  getTextDatum(void);
+    void     setFreeFont(const GFXfont *f = NULL);
+    int16_t  drawString(const char *string, int32_t x, int32_t y);
+    int16_t  textWidth(const char *string);
+
+    uint16_t color565(uint8_t red, uint8_t green, uint8_t blue);
+
+    // host only: recorded primitives since the last hostClearOps()
+    const std::vector<tft_op>& hostOps(void) const { return _ops; }
+    size_t   hostOpCount(tft_op_kind kind) const;
+    void     hostClearOps(void) { _ops.clear(); }
+    void     hostRecord(bool on) { _recording = on; }
+
+    // host only: bus traffic since the last hostBusReset()
+    const tft_bus_stats& hostBusStats(void) const { return _bus; }
+    const tft_bus_stats& hostBusStats(tft_op_kind kind) const { return _bus_kind[kind]; }
+    void     hostBusReset(void) { memset(&_bus, 0, sizeof(_bus)); memset(_bus_kind, 0, sizeof(_bus_kind)); }
+
+    // host only: RGB565 framebuffer of what the panel shows, written by the bus
+    // layer in address window order. off by default, turning it on clears it to black
+    void     hostFramebuffer(bool on);
+    bool     hostFramebufferOn(void) const { return !_fb.empty(); }
+    uint16_t hostPixel(int32_t x, int32_t y) const;
+    uint32_t hostFramebufferCrc(void) const;
+    bool     hostWritePPM(const char *path) const;
+
+    // host only: a rectangle read as black by hostFramebufferCrc() and
+    // hostWritePPM(), for figures that vary from run to run. hostUnmask()
+    // drops them all
+    void     hostMask(int32_t x, int32_t y, int32_t w, int32_t h);
+    void     hostUnmask(void) { _masks.clear(); }
+
+  protected:
+    void     _record(tft_op_kind kind, int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color, uint32_t bg, const char *text = NULL);
+    void     _account(tft_op_kind kind, const tft_bus_stats& before);
+
+    // TFT_eSPI internals, without recording
+    void     _pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data);
+    void     _fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void     _drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color);
+    void     _drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color);
+    void     _drawPixel(int32_t x, int32_t y, uint32_t color);
+    void     _fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t cornername, int32_t delta, uint32_t color);
+    int16_t  _drawChar(uint16_t c, int32_t x, int32_t y);
+
+    // bus layer
+    void     _begin_tft_write(void);
+    void     _end_tft_write(void);
+    void     _setWindow(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+    void     _pushBlock(uint16_t color, uint32_t len);
+    void     _pushPixels(const uint16_t *data, uint32_t len);
+    void     _fbWrite(uint16_t color);
+    uint16_t _fbRead(size_t index) const;
+
+    bool     _locked = true;
+    bool     _inTransaction = false;
+    bool     _lockTransaction = false;
+    int32_t  _addr_row = -1, _addr_col = -1;
+    int32_t  _win_x0 = 0, _win_y0 = 0, _win_x1 = 0, _win_y1 = 0;
+    int32_t  _win_x = 0, _win_y = 0;
+    std::vector<uint16_t> _fb;
+    std::vector<tft_rect> _masks;
+    tft_bus_stats _bus = {};
+    tft_bus_stats _bus_kind[TFT_OP_KIND_COUNT] = {};
+
+    int16_t  _init_width, _init_height;
+    int16_t  _width, _height;
+    uint8_t  _rotation = 0;
+    bool     _swapBytes = false;
+
+    uint16_t _textcolor = 0xFFFF, _textbgcolor = 0x0000;
+    uint8_t  _textdatum = TL_DATUM;
+    const GFXfont *_gfxFont = NULL;
+    uint8_t  _glyph_ab = 0, _glyph_bb = 0;
+
+    std::vector<tft_op> _ops;
+    bool     _recording = true;
+};
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * WiFi.h
+ * host stand-in for the ESP32 WiFi library
+ *
+ * connection state, IP and MAC are set by the host via the host...() members
+ */
+
+#ifndef WiFi_h
+#define WiFi_h
+
+#include <Arduino.h>
+
+typedef enum
+{
+  WL_IDLE_STATUS      = 0,
+  WL_NO_SSID_AVAIL    = 1,
+  WL_SCAN_COMPLETED   = 2,
+  WL_CONNECTED        = 3,
+  WL_CONNECT_FAILED   = 4,
+  WL_CONNECTION_LOST  = 5,
+  WL_DISCONNECTED     = 6
+} wl_status_t;
+
+class WiFiClass
+{
+  public:
+    uint8_t * macAddress(uint8_t * mac) { memcpy(mac, _mac, 6); return mac; }
+    IPAddress localIP(void) { return _ip; }
+    wl_status_t status(void) { return _status; }
+
+    // host only
+    void hostSetStatus(wl_status_t status) { _status = status; }
+    void hostSetIP(IPAddress ip) { _ip = ip; }
+    void hostSetMAC(const uint8_t * mac) { memcpy(_mac, mac, 6); }
+
+  private:
+    wl_status_t _status = WL_DISCONNECTED;
+    IPAddress _ip;
+    uint8_t _mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+};
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * pgmspace.h
+ * host stand-in, PROGMEM is ordinary memory on Linux
+ */
+
+#ifndef PGMSPACE_INCLUDE
+#define PGMSPACE_INCLUDE
+
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)                 (s)
+#define memcpy_P                memcpy
+#define strlen_P                strlen
+#define pgm_read_byte(addr)     (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)    (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)      (*(void * const *)(addr))
+
+#endif